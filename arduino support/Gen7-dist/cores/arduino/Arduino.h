@@ -106,21 +106,172 @@ void pinMode(uint8_t, uint8_t);
 void digitalWrite(uint8_t, uint8_t);
 int digitalRead(uint8_t);
 int analogRead(uint8_t);
+// 8 bit result; -1 like analogRead() while background sampling doesn't
+// cover the pin
+int analogReadFast(uint8_t);
 void analogReference(uint8_t mode);
 void analogWrite(uint8_t, int);
+unsigned long analogWriteConfig(uint8_t pin, unsigned long freq, uint8_t bits);
+
+// Background sampling: the ADC interrupt cycles through the given pins
+// with the converter free running. Each result is the mean of
+// 2^oversampleShift conversions (shift 0..6).
+#define ANALOG_SAMPLE_MAX_CHANNELS 8
+uint8_t analogSampleBegin(const uint8_t *pins, uint8_t count, uint8_t oversampleShift);
+void analogSampleEnd(void);
+// latest mean, or -1 if the pin isn't sampled or has no result yet
+int analogLatest(uint8_t pin);
+// latest sum of 2^oversampleShift conversions, for the extra resolution
+long analogLatestSum(uint8_t pin);
 
 unsigned long millis(void);
 unsigned long micros(void);
+// time stamps which don't wrap, with the 64 cycle resolution of Timer0
+uint64_t cycles64(void);
+uint64_t micros64(void);
 void delay(unsigned long);
+// sleeps until millis() reaches deadline, calling yield() meanwhile
+void idleUntil(unsigned long deadline);
+void yield(void);
 void delayMicroseconds(unsigned int us);
 unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout);
 
+// Interrupt driven pulse measurement on the input capture pin (ICP1, PD6,
+// digital pin 14 on Gen7), which pulseCaptureBegin() makes an input.
+// Takes over Timer1 until pulseCaptureEnd(), so its PWM pins stop.
+// Does nothing with the profiler built in, see Profiler.h.
+// Results are in microseconds, 0 until measured.
+void pulseCaptureBegin(void);
+void pulseCaptureEnd(void);
+uint8_t pulseCaptureAvailable(void);
+unsigned long pulseCaptureHigh(void);
+unsigned long pulseCaptureLow(void);
+unsigned long pulseCapturePeriod(void);
+
 void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val);
 uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder);
+// several bytes in a row; on the SPI pins the next byte is fetched while
+// the previous one is on the wire
+void shiftOutBuf(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, const uint8_t *buf, size_t len);
+void shiftInBuf(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t *buf, size_t len);
+
+// A pin resolved once with pinResolve(), for pin numbers known only at
+// runtime, e.g. read from EEPROM. fastPinHigh() and friends then take a
+// few instructions instead of digitalWrite()'s table lookups. Like
+// digitalWrite(), pinResolve() turns off PWM on the pin.
+typedef struct {
+	volatile uint8_t *out;
+	volatile uint8_t *in;
+	uint8_t mask;
+} FastPin;
+
+uint8_t pinResolve(FastPin *fp, uint8_t pin);
+
+// Writing a one to a PINx bit toggles the pin on all but the oldest ATmegas.
+#if !defined(__AVR_ATmega8__) && !defined(__AVR_ATmega16__) && \
+    !defined(__AVR_ATmega32__) && !defined(__AVR_ATmega64__) && \
+    !defined(__AVR_ATmega128__)
+#define HAVE_PIN_TOGGLE 1
+#endif
+
+static inline void fastPinHigh(const FastPin *fp)
+{
+	uint8_t oldSREG = SREG;
+	cli();
+	*fp->out |= fp->mask;
+	SREG = oldSREG;
+}
+
+static inline void fastPinLow(const FastPin *fp)
+{
+	uint8_t oldSREG = SREG;
+	cli();
+	*fp->out &= ~fp->mask;
+	SREG = oldSREG;
+}
+
+static inline void fastPinWrite(const FastPin *fp, uint8_t val)
+{
+	if (val == LOW) fastPinLow(fp);
+	else fastPinHigh(fp);
+}
+
+static inline void fastPinToggle(const FastPin *fp)
+{
+#ifdef HAVE_PIN_TOGGLE
+	// a single store, atomic without disabling interrupts
+	*fp->in = fp->mask;
+#else
+	uint8_t oldSREG = SREG;
+	cli();
+	*fp->out ^= fp->mask;
+	SREG = oldSREG;
+#endif
+}
+
+static inline uint8_t fastPinRead(const FastPin *fp)
+{
+	return (*fp->in & fp->mask) ? HIGH : LOW;
+}
+
+// Sets the bits in mask of an output port to those in value, with a
+// single read-modify-write.
+static inline void writePortMasked(volatile uint8_t *port, uint8_t mask, uint8_t value)
+{
+	uint8_t oldSREG = SREG;
+	cli();
+	*port = (*port & ~mask) | (value & mask);
+	SREG = oldSREG;
+}
+
+// A set of pins grouped by port at setup time, so pinGroupWrite() can
+// switch them together with one read-modify-write per port. Meant for
+// e.g. the step pins of all axes, to get simultaneous step edges.
+#define PIN_GROUP_MAX_PINS 8
+#define PIN_GROUP_MAX_PORTS 4
+
+typedef struct {
+	uint8_t count;                              // number of pins
+	uint8_t ports;                              // number of ports used
+	volatile uint8_t *out[PIN_GROUP_MAX_PORTS];
+	uint8_t portMask[PIN_GROUP_MAX_PORTS];      // all group pins on a port
+	uint8_t pinPort[PIN_GROUP_MAX_PINS];        // index into out[] per pin
+	uint8_t pinMask[PIN_GROUP_MAX_PINS];        // port bit per pin
+} PinGroup;
+
+uint8_t pinGroupInit(PinGroup *g, const uint8_t *pins, uint8_t count);
+// bit n of select picks pins[n], bit n of values is the level to write
+void pinGroupWrite(const PinGroup *g, uint8_t select, uint8_t values);
 
 void attachInterrupt(uint8_t, void (*)(void), int mode);
 void detachInterrupt(uint8_t);
 
+// INTERRUPT_HANDLER(n) { ... } defines the handler of external interrupt n
+// (a literal number) at compile time. It is the interrupt vector itself,
+// so the handler body is compiled into it, without the indirect call and
+// the register saving that comes with it. It replaces the vector of
+// attachInterrupt(); call attachInterrupt(n, 0, mode) to set the mode.
+#if defined(EICRA) && defined(EICRB) && !defined(__AVR_ATmega32U4__)
+#define EXTERNAL_INT_VECTOR_0 INT4_vect
+#define EXTERNAL_INT_VECTOR_1 INT5_vect
+#define EXTERNAL_INT_VECTOR_2 INT0_vect
+#define EXTERNAL_INT_VECTOR_3 INT1_vect
+#define EXTERNAL_INT_VECTOR_4 INT2_vect
+#define EXTERNAL_INT_VECTOR_5 INT3_vect
+#define EXTERNAL_INT_VECTOR_6 INT6_vect
+#define EXTERNAL_INT_VECTOR_7 INT7_vect
+#else
+#define EXTERNAL_INT_VECTOR_0 INT0_vect
+#define EXTERNAL_INT_VECTOR_1 INT1_vect
+#define EXTERNAL_INT_VECTOR_2 INT2_vect
+#define EXTERNAL_INT_VECTOR_3 INT3_vect
+#endif
+#define INTERRUPT_HANDLER(interruptNum) ISR(EXTERNAL_INT_VECTOR_##interruptNum)
+
+// any pin with a pin change interrupt; mode is CHANGE, RISING or FALLING
+void attachPinChangeInterrupt(uint8_t pin, void (*)(void), int mode);
+void detachPinChangeInterrupt(uint8_t pin);
+
 void setup(void);
 void loop(void);
 
@@ -197,6 +348,7 @@ extern const uint8_t PROGMEM digital_pin_to_timer_PGM[];
 #ifdef __cplusplus
 #include "WCharacter.h"
 #include "WString.h"
+#include "FixedString.h"
 #include "HardwareSerial.h"
 
 uint16_t makeWord(uint16_t w);
@@ -208,6 +360,8 @@ unsigned long pulseIn(uint8_t pin, uint8_t state, unsigned long timeout = 100000
 
 void tone(uint8_t _pin, unsigned int frequency, unsigned long duration = 0);
 void noTone(uint8_t _pin);
+// plays after the notes queued before; a frequency of 0 is a rest
+bool toneQueue(uint8_t _pin, unsigned int frequency, unsigned long duration);
 
 // WMath prototypes
 long random(long);
@@ -219,4 +373,47 @@ long map(long, long, long, long, long);
 
 #include "pins_arduino.h"
 
+// digitalWriteFast(), digitalReadFast() and pinModeFast() compile down to
+// single sbi/cbi/sbic instructions if the pin number is a compile time
+// constant and the variant provides digitalPinToPortReg() and friends.
+// Otherwise they fall back to the regular functions. Unlike digitalWrite()
+// and digitalRead(), they don't turn off PWM on the pin; use analogWrite()
+// with 0 or 255 or a single digitalWrite() for that.
+#if defined(digitalPinToPortReg)
+#define digitalWriteFast(P, V) \
+	do { \
+		if (__builtin_constant_p(P) && (P) < NUM_DIGITAL_PINS) { \
+			if (V) *digitalPinToPortReg(P) |= _BV(digitalPinToBit(P)); \
+			else *digitalPinToPortReg(P) &= ~_BV(digitalPinToBit(P)); \
+		} \
+		else digitalWrite((P), (V)); \
+	} while (0)
+
+#define digitalReadFast(P) \
+	((__builtin_constant_p(P) && (P) < NUM_DIGITAL_PINS) ? \
+		((*digitalPinToPINReg(P) & _BV(digitalPinToBit(P))) ? HIGH : LOW) : \
+		digitalRead((P)))
+
+#define pinModeFast(P, M) \
+	do { \
+		if (__builtin_constant_p(P) && __builtin_constant_p(M) && \
+		    (P) < NUM_DIGITAL_PINS) { \
+			if ((M) == OUTPUT) { \
+				*digitalPinToDDRReg(P) |= _BV(digitalPinToBit(P)); \
+			} else { \
+				*digitalPinToDDRReg(P) &= ~_BV(digitalPinToBit(P)); \
+				if ((M) == INPUT_PULLUP) \
+					*digitalPinToPortReg(P) |= _BV(digitalPinToBit(P)); \
+				else \
+					*digitalPinToPortReg(P) &= ~_BV(digitalPinToBit(P)); \
+			} \
+		} \
+		else pinMode((P), (M)); \
+	} while (0)
+#else
+#define digitalWriteFast(P, V) digitalWrite((P), (V))
+#define digitalReadFast(P) digitalRead((P))
+#define pinModeFast(P, M) pinMode((P), (M))
+#endif
+
 #endif
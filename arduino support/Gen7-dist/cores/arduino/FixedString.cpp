@@ -0,0 +1,372 @@
+/*
+  FixedString.cpp - heap-free string classes for Wiring & Arduino
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "FixedString.h"
+
+
+/*********************************************/
+/*  StringView Comparison                    */
+/*********************************************/
+
+unsigned char StringView::equals(const StringView &s) const
+{
+	return len == s.len && memcmp(buffer, s.buffer, len) == 0;
+}
+
+unsigned char StringView::equalsIgnoreCase(const StringView &s) const
+{
+	if (len != s.len) return 0;
+	for (unsigned int i = 0; i < len; i++) {
+		if (tolower(buffer[i]) != tolower(s.buffer[i])) return 0;
+	}
+	return 1;
+}
+
+unsigned char StringView::startsWith(const StringView &prefix) const
+{
+	return startsWith(prefix, 0);
+}
+
+unsigned char StringView::startsWith(const StringView &prefix, unsigned int offset) const
+{
+	if (offset > len || prefix.len > len - offset) return 0;
+	return memcmp(buffer + offset, prefix.buffer, prefix.len) == 0;
+}
+
+unsigned char StringView::endsWith(const StringView &suffix) const
+{
+	if (suffix.len > len) return 0;
+	return memcmp(buffer + len - suffix.len, suffix.buffer, suffix.len) == 0;
+}
+
+/*********************************************/
+/*  StringView Character Access              */
+/*********************************************/
+
+char StringView::charAt(unsigned int index) const
+{
+	return operator[](index);
+}
+
+char StringView::operator[](unsigned int index) const
+{
+	if (index >= len) return 0;
+	return buffer[index];
+}
+
+void StringView::getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index) const
+{
+	if (!bufsize || !buf) return;
+	if (index >= len) {
+		buf[0] = 0;
+		return;
+	}
+	unsigned int n = bufsize - 1;
+	if (n > len - index) n = len - index;
+	memcpy(buf, buffer + index, n);
+	buf[n] = 0;
+}
+
+/*********************************************/
+/*  StringView Search                        */
+/*********************************************/
+
+int StringView::indexOf(char ch) const
+{
+	return indexOf(ch, 0);
+}
+
+int StringView::indexOf(char ch, unsigned int fromIndex) const
+{
+	if (fromIndex >= len) return -1;
+	const char *found = (const char *)memchr(buffer + fromIndex, ch, len - fromIndex);
+	if (found == NULL) return -1;
+	return found - buffer;
+}
+
+int StringView::indexOf(const StringView &s) const
+{
+	return indexOf(s, 0);
+}
+
+int StringView::indexOf(const StringView &s, unsigned int fromIndex) const
+{
+	if (s.len == 0 || fromIndex >= len || s.len > len - fromIndex) return -1;
+	unsigned int last = len - s.len;
+	for (unsigned int i = fromIndex; i <= last; i++) {
+		if (buffer[i] == s.buffer[0] &&
+		    memcmp(buffer + i + 1, s.buffer + 1, s.len - 1) == 0) return i;
+	}
+	return -1;
+}
+
+int StringView::lastIndexOf(char ch) const
+{
+	return lastIndexOf(ch, len - 1);
+}
+
+int StringView::lastIndexOf(char ch, unsigned int fromIndex) const
+{
+	if (len == 0) return -1;
+	if (fromIndex >= len) fromIndex = len - 1;
+	for (int i = fromIndex; i >= 0; i--) {
+		if (buffer[i] == ch) return i;
+	}
+	return -1;
+}
+
+int StringView::lastIndexOf(const StringView &s) const
+{
+	return lastIndexOf(s, len - s.len);
+}
+
+int StringView::lastIndexOf(const StringView &s, unsigned int fromIndex) const
+{
+	if (s.len == 0 || s.len > len) return -1;
+	if (fromIndex > len - s.len) fromIndex = len - s.len;
+	for (int i = fromIndex; i >= 0; i--) {
+		if (memcmp(buffer + i, s.buffer, s.len) == 0) return i;
+	}
+	return -1;
+}
+
+StringView StringView::substring(unsigned int left) const
+{
+	return substring(left, len);
+}
+
+StringView StringView::substring(unsigned int left, unsigned int right) const
+{
+	if (left > right) {
+		unsigned int temp = right;
+		right = left;
+		left = temp;
+	}
+	if (left > len) return StringView();
+	if (right > len) right = len;
+	return StringView(buffer + left, right - left);
+}
+
+StringView StringView::trimmed(void) const
+{
+	unsigned int begin = 0, end = len;
+	while (begin < end && isspace(buffer[begin])) begin++;
+	while (end > begin && isspace(buffer[end - 1])) end--;
+	return StringView(buffer + begin, end - begin);
+}
+
+/*********************************************/
+/*  StringView Parsing / Conversion          */
+/*********************************************/
+
+long StringView::toInt(void) const
+{
+	unsigned int i = 0;
+	unsigned char negative = 0;
+	long value = 0;
+
+	while (i < len && isspace(buffer[i])) i++;
+	if (i < len && (buffer[i] == '-' || buffer[i] == '+')) {
+		negative = buffer[i] == '-';
+		i++;
+	}
+	while (i < len && buffer[i] >= '0' && buffer[i] <= '9') {
+		value = value * 10 + buffer[i] - '0';
+		i++;
+	}
+	return negative ? -value : value;
+}
+
+/*********************************************/
+/*  FixedString Memory Management            */
+/*********************************************/
+
+void FixedStringBase::clear(void)
+{
+	len = 0;
+	wbuffer()[0] = 0;
+}
+
+unsigned char FixedStringBase::assign(const StringView &s)
+{
+	if (s.length() > cap) return 0;
+	len = s.length();
+	// memmove(), as s may be a view into ourselves
+	memmove(wbuffer(), s.data(), len);
+	wbuffer()[len] = 0;
+	return 1;
+}
+
+/*********************************************/
+/*  FixedString concat                       */
+/*********************************************/
+
+unsigned char FixedStringBase::concat(const StringView &s)
+{
+	if (s.length() > cap - len) return 0;
+	memmove(wbuffer() + len, s.data(), s.length());
+	len += s.length();
+	wbuffer()[len] = 0;
+	return 1;
+}
+
+unsigned char FixedStringBase::concat(char c)
+{
+	if (len >= cap) return 0;
+	wbuffer()[len++] = c;
+	wbuffer()[len] = 0;
+	return 1;
+}
+
+unsigned char FixedStringBase::concat(unsigned char num)
+{
+	char buf[4];
+	utoa(num, buf, 10);
+	return concat(StringView(buf));
+}
+
+unsigned char FixedStringBase::concat(int num)
+{
+	char buf[7];
+	itoa(num, buf, 10);
+	return concat(StringView(buf));
+}
+
+unsigned char FixedStringBase::concat(unsigned int num)
+{
+	char buf[6];
+	utoa(num, buf, 10);
+	return concat(StringView(buf));
+}
+
+unsigned char FixedStringBase::concat(long num)
+{
+	char buf[12];
+	ltoa(num, buf, 10);
+	return concat(StringView(buf));
+}
+
+unsigned char FixedStringBase::concat(unsigned long num)
+{
+	char buf[11];
+	ultoa(num, buf, 10);
+	return concat(StringView(buf));
+}
+
+/*********************************************/
+/*  FixedString Character Access             */
+/*********************************************/
+
+void FixedStringBase::setCharAt(unsigned int index, char c)
+{
+	if (index < len) wbuffer()[index] = c;
+}
+
+char & FixedStringBase::operator[](unsigned int index)
+{
+	static char dummy_writable_char;
+	if (index >= len) {
+		dummy_writable_char = 0;
+		return dummy_writable_char;
+	}
+	return wbuffer()[index];
+}
+
+/*********************************************/
+/*  FixedString Modification                 */
+/*********************************************/
+
+void FixedStringBase::replace(char find, char replace)
+{
+	char *p = wbuffer();
+	for (unsigned int i = 0; i < len; i++) {
+		if (p[i] == find) p[i] = replace;
+	}
+}
+
+unsigned char FixedStringBase::replace(const StringView &find, const StringView &replace)
+{
+	if (len == 0 || find.length() == 0) return 1;
+	int diff = replace.length() - find.length();
+	char *p = wbuffer();
+	int index;
+
+	// views into ourselves would change with the moves below, so work
+	// with copies of them
+	if ((find.data() <= p + cap && find.data() + find.length() > p) ||
+	    (replace.data() <= p + cap && replace.data() + replace.length() > p)) {
+		char aside[find.length() + replace.length()];
+		memcpy(aside, find.data(), find.length());
+		memcpy(aside + find.length(), replace.data(), replace.length());
+		return this->replace(StringView(aside, find.length()),
+		                     StringView(aside + find.length(), replace.length()));
+	}
+
+	if (diff > 0) {
+		// check the result fits before touching anything
+		unsigned int size = len;
+		index = 0;
+		while ((index = indexOf(find, index)) >= 0) {
+			size += diff;
+			index += find.length();
+		}
+		if (size > cap) return 0;
+	}
+
+	index = 0;
+	while ((index = indexOf(find, index)) >= 0) {
+		unsigned int tail = index + find.length();
+		memmove(p + tail + diff, p + tail, len - tail);
+		memcpy(p + index, replace.data(), replace.length());
+		len += diff;
+		index += replace.length();
+	}
+	p[len] = 0;
+	return 1;
+}
+
+void FixedStringBase::remove(unsigned int index, unsigned int count)
+{
+	if (index >= len) return;
+	if (count > len - index) count = len - index;
+	char *p = wbuffer();
+	memmove(p + index, p + index + count, len - index - count);
+	len -= count;
+	p[len] = 0;
+}
+
+void FixedStringBase::toLowerCase(void)
+{
+	char *p = wbuffer();
+	for (unsigned int i = 0; i < len; i++) {
+		p[i] = tolower(p[i]);
+	}
+}
+
+void FixedStringBase::toUpperCase(void)
+{
+	char *p = wbuffer();
+	for (unsigned int i = 0; i < len; i++) {
+		p[i] = toupper(p[i]);
+	}
+}
+
+void FixedStringBase::trim(void)
+{
+	assign(trimmed());
+}
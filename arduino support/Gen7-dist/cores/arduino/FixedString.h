@@ -0,0 +1,165 @@
+/*
+  FixedString.h - heap-free string classes for Wiring & Arduino
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef FixedString_class_h
+#define FixedString_class_h
+#ifdef __cplusplus
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+// String has to realloc() on almost every modification, which fragments
+// the few kilobytes of heap an ATmega has. The classes here offer the
+// same search and parsing methods without ever touching the heap:
+//
+//   StringView      - a read-only window onto characters stored elsewhere.
+//                     Not necessarily null terminated.
+//   FixedString<N>  - owns storage for up to N characters (plus the '\0'),
+//                     lives on the stack or in static memory.
+//
+// Methods taking text accept a StringView, so "strings", FixedStrings
+// and views can be mixed freely.
+
+// A read-only reference to a run of characters
+class StringView
+{
+public:
+	StringView() : buffer(""), len(0) {}
+	StringView(const char *cstr) : buffer(cstr ? cstr : ""), len(cstr ? strlen(cstr) : 0) {}
+	StringView(const char *buf, unsigned int length) : buffer(buf), len(length) {}
+
+	inline unsigned int length(void) const {return len;}
+	inline const char *data(void) const {return buffer;}
+
+	// comparison
+	unsigned char equals(const StringView &s) const;
+	unsigned char equalsIgnoreCase(const StringView &s) const;
+	unsigned char operator == (const StringView &rhs) const {return equals(rhs);}
+	unsigned char operator != (const StringView &rhs) const {return !equals(rhs);}
+	unsigned char startsWith(const StringView &prefix) const;
+	unsigned char startsWith(const StringView &prefix, unsigned int offset) const;
+	unsigned char endsWith(const StringView &suffix) const;
+
+	// character access
+	char charAt(unsigned int index) const;
+	char operator [] (unsigned int index) const;
+	void getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index=0) const;
+	void toCharArray(char *buf, unsigned int bufsize, unsigned int index=0) const
+		{getBytes((unsigned char *)buf, bufsize, index);}
+
+	// search
+	int indexOf(char ch) const;
+	int indexOf(char ch, unsigned int fromIndex) const;
+	int indexOf(const StringView &str) const;
+	int indexOf(const StringView &str, unsigned int fromIndex) const;
+	int lastIndexOf(char ch) const;
+	int lastIndexOf(char ch, unsigned int fromIndex) const;
+	int lastIndexOf(const StringView &str) const;
+	int lastIndexOf(const StringView &str, unsigned int fromIndex) const;
+
+	// sub-views share the characters, nothing is copied
+	StringView substring(unsigned int beginIndex) const;
+	StringView substring(unsigned int beginIndex, unsigned int endIndex) const;
+	StringView trimmed(void) const;
+
+	// parsing/conversion, same rules as atol()
+	long toInt(void) const;
+
+protected:
+	const char *buffer;	// the characters, not necessarily null terminated
+	unsigned int len;	// number of characters
+};
+
+// Code shared by all FixedString<N>, so the template itself stays tiny.
+// Modifications which don't fit into the storage return false and leave
+// the string unchanged.
+class FixedStringBase : public StringView
+{
+public:
+	inline unsigned int capacity(void) const {return cap;}
+	inline const char *c_str(void) const {return buffer;}
+	void clear(void);
+
+	unsigned char assign(const StringView &s);
+
+	unsigned char concat(const StringView &s);
+	unsigned char concat(char c);
+	unsigned char concat(unsigned char num);
+	unsigned char concat(int num);
+	unsigned char concat(unsigned int num);
+	unsigned char concat(long num);
+	unsigned char concat(unsigned long num);
+
+	FixedStringBase & operator += (const StringView &rhs)	{concat(rhs); return (*this);}
+	FixedStringBase & operator += (const char *cstr)	{concat(StringView(cstr)); return (*this);}
+	FixedStringBase & operator += (char c)			{concat(c); return (*this);}
+	FixedStringBase & operator += (unsigned char num)	{concat(num); return (*this);}
+	FixedStringBase & operator += (int num)			{concat(num); return (*this);}
+	FixedStringBase & operator += (unsigned int num)	{concat(num); return (*this);}
+	FixedStringBase & operator += (long num)		{concat(num); return (*this);}
+	FixedStringBase & operator += (unsigned long num)	{concat(num); return (*this);}
+
+	// character access
+	void setCharAt(unsigned int index, char c);
+	char operator [] (unsigned int index) const {return StringView::operator[](index);}
+	char& operator [] (unsigned int index);
+
+	// modification
+	void replace(char find, char replace);
+	unsigned char replace(const StringView &find, const StringView &replace);
+	void remove(unsigned int index, unsigned int count);
+	void toLowerCase(void);
+	void toUpperCase(void);
+	void trim(void);
+
+protected:
+	FixedStringBase(char *storage, unsigned int capacity)
+		: StringView(storage, 0), cap(capacity) {storage[0] = 0;}
+	inline char *wbuffer(void) {return const_cast<char *>(buffer);}
+
+	unsigned int cap;	// storage size minus one (for the '\0')
+
+	friend class Stream;
+
+private:
+	// copying a base would alias the storage of another object
+	FixedStringBase(const FixedStringBase &);
+	FixedStringBase & operator = (const FixedStringBase &);
+};
+
+// The string class with storage for N characters
+template <unsigned int N>
+class FixedString : public FixedStringBase
+{
+public:
+	FixedString() : FixedStringBase(storage, N) {}
+	FixedString(const char *cstr) : FixedStringBase(storage, N) {assign(StringView(cstr));}
+	FixedString(const StringView &s) : FixedStringBase(storage, N) {assign(s);}
+	FixedString(const FixedString &s) : FixedStringBase(storage, N) {assign(s);}
+
+	FixedString & operator = (const FixedString &rhs) {assign(rhs); return *this;}
+	FixedString & operator = (const StringView &rhs) {assign(rhs); return *this;}
+	FixedString & operator = (const char *cstr) {assign(StringView(cstr)); return *this;}
+
+private:
+	char storage[N + 1];
+};
+
+#endif  // __cplusplus
+#endif  // FixedString_class_h
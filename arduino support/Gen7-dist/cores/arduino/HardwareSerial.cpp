@@ -124,6 +124,7 @@ inline void store_char(unsigned char c, ring_buffer *buffer)
   SIGNAL(SIG_UART_RECV)
 #endif
   {
+    PROFILE_ISR_BEGIN();
   #if defined(UDR0)
     if (bit_is_clear(UCSR0A, UPE0)) {
       unsigned char c = UDR0;
@@ -141,6 +142,7 @@ inline void store_char(unsigned char c, ring_buffer *buffer)
   #else
     #error UDR not defined
   #endif
+    PROFILE_ISR_END(PROFILE_SERIAL_RX);
   }
 #endif
 #endif
@@ -151,12 +153,14 @@ inline void store_char(unsigned char c, ring_buffer *buffer)
   #define serialEvent1_implemented
   SIGNAL(USART1_RX_vect)
   {
+    PROFILE_ISR_BEGIN();
     if (bit_is_clear(UCSR1A, UPE1)) {
       unsigned char c = UDR1;
       store_char(c, &rx_buffer1);
     } else {
       unsigned char c = UDR1;
     };
+    PROFILE_ISR_END(PROFILE_SERIAL1_RX);
   }
 #elif defined(SIG_USART1_RECV)
   #error SIG_USART1_RECV
@@ -229,6 +233,7 @@ ISR(USART0_UDRE_vect)
 ISR(USART_UDRE_vect)
 #endif
 {
+  PROFILE_ISR_BEGIN();
   if (tx_buffer.head == tx_buffer.tail) {
 	// Buffer empty, so disable interrupts
 #if defined(UCSR0B)
@@ -250,6 +255,7 @@ ISR(USART_UDRE_vect)
     #error UDR not defined
   #endif
   }
+  PROFILE_ISR_END(PROFILE_SERIAL_UDRE);
 }
 #endif
 #endif
@@ -257,6 +263,7 @@ ISR(USART_UDRE_vect)
 #ifdef USART1_UDRE_vect
 ISR(USART1_UDRE_vect)
 {
+  PROFILE_ISR_BEGIN();
   if (tx_buffer1.head == tx_buffer1.tail) {
 	// Buffer empty, so disable interrupts
     cbi(UCSR1B, UDRIE1);
@@ -268,6 +275,7 @@ ISR(USART1_UDRE_vect)
 	
     UDR1 = c;
   }
+  PROFILE_ISR_END(PROFILE_SERIAL1_UDRE);
 }
 #endif
 
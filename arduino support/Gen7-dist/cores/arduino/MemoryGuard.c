@@ -0,0 +1,116 @@
+/*
+  MemoryGuard.c - halts before the stack runs into the heap
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#include "wiring_private.h"
+#include "MemoryMonitor.h"
+
+#if defined(TIMER0_COMPA_vect) && defined(OCIE0A)
+
+extern char __heap_start;
+extern char *__brkval;
+
+// Checking the stack pointer alone would only catch the stack when it is
+// deep at the moment of the interrupt, so the last MEMORY_GUARD_BAND bytes
+// before the margin are painted and checked as well. They are free memory
+// as long as the stack doesn't reach them.
+//
+// When the heap end moves, the band is repainted from the main loop, not
+// the interrupt: the interrupt may come while malloc() or free() have
+// written one byte of __brkval only, and painting at such a half written
+// address would overwrite heap blocks in use.
+#define MEMORY_GUARD_BAND 8
+
+static unsigned int guard_margin;
+static char * volatile guard_heap;	// heap end the band was painted for
+
+static char *heapEnd(void)
+{
+	return __brkval ? __brkval : &__heap_start;
+}
+
+void memoryGuardBegin(unsigned int margin)
+{
+	uint8_t oldSREG = SREG;
+
+	cli();
+	guard_margin = margin < MEMORY_GUARD_BAND ? MEMORY_GUARD_BAND : margin;
+	guard_heap = 0;
+	// timer0 keeps running as it is; OCR0A may be in use by analogWrite(),
+	// but the compare matches once per timer0 period whatever its value
+	TIFR0 = (1 << OCF0A);
+	TIMSK0 |= (1 << OCIE0A);
+	SREG = oldSREG;
+
+	memoryGuardService();
+}
+
+void memoryGuardEnd(void)
+{
+	TIMSK0 &= ~(1 << OCIE0A);
+}
+
+void memoryGuardService(void)
+{
+	char *heap = heapEnd();
+	char *band;
+	uint8_t i;
+
+	if (heap == guard_heap || !(TIMSK0 & (1 << OCIE0A))) return;
+
+	uint8_t oldSREG = SREG;
+	cli();
+	// if the stack is in the band already, the interrupt halts anyway
+	band = heap + guard_margin - MEMORY_GUARD_BAND;
+	if ((char *)SP >= heap + guard_margin) {
+		for (i = 0; i < MEMORY_GUARD_BAND; i++) band[i] = MEMORY_PAINT;
+		guard_heap = heap;
+	}
+	SREG = oldSREG;
+}
+
+static void memoryHalt(void) __attribute__((noreturn));
+static void memoryHalt(void)
+{
+	if (memoryOverflow) memoryOverflow();
+	cli();
+	for (;;);
+}
+
+ISR(TIMER0_COMPA_vect)
+{
+	char *heap = guard_heap;
+	char *band;
+	uint8_t i;
+
+	if (heap == 0) return;	// not painted yet
+	if ((char *)SP < heap + guard_margin) memoryHalt();
+
+	// the heap end moved since the band was painted, so the band may be
+	// heap memory now; wait for memoryGuardService() to paint a new one.
+	// A half written __brkval doesn't match either.
+	if (heapEnd() != heap) return;
+
+	band = heap + guard_margin - MEMORY_GUARD_BAND;
+	for (i = 0; i < MEMORY_GUARD_BAND; i++) {
+		if (band[i] != (char)MEMORY_PAINT) memoryHalt();
+	}
+}
+
+#endif
@@ -0,0 +1,78 @@
+/*
+  MemoryMonitor.c - stack and heap usage of the sketch
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#include <stdlib.h>
+#include "wiring_private.h"
+#include "MemoryMonitor.h"
+
+extern char __heap_start;
+extern char *__brkval;
+
+// the free list of malloc(), see avr-libc's stdlib_private.h
+struct __freelist {
+	size_t sz;
+	struct __freelist *nx;
+};
+extern struct __freelist *__flp;
+
+// Runs right after reset, before the stack pointer is set up and the
+// variables are initialised, so it must neither use the stack nor rely
+// on r1 being zero. Falls through into .init2.
+void memoryPaint(void) __attribute__((naked, used, section(".init1")));
+void memoryPaint(void)
+{
+	__asm__ __volatile__ (
+		"	ldi r30, lo8(__heap_start)\n"
+		"	ldi r31, hi8(__heap_start)\n"
+		"	ldi r24, %[paint]\n"
+		"	ldi r25, hi8(%[end])\n"
+		"1:	st Z+, r24\n"
+		"	cpi r30, lo8(%[end])\n"
+		"	cpc r31, r25\n"
+		"	brne 1b\n"
+		:: [paint] "M" (MEMORY_PAINT), [end] "i" (RAMEND + 1)
+	);
+}
+
+void memStats(MemStats *stats)
+{
+	char *heap, *p, *sp;
+	struct __freelist *f;
+	unsigned int free = 0, largest = 0;
+	uint8_t oldSREG = SREG;
+
+	cli();
+	heap = __brkval ? __brkval : &__heap_start;
+	for (f = __flp; f; f = f->nx) {
+		free += f->sz;
+		if (f->sz > largest) largest = f->sz;
+	}
+	SREG = oldSREG;
+
+	sp = (char *)SP;
+	for (p = heap; p <= sp && *p == (char)MEMORY_PAINT; p++);
+
+	stats->unused = p - heap;
+	stats->stackMax = (char *)RAMEND + 1 - p;
+	stats->heapSize = heap - &__heap_start;
+	stats->heapFree = free;
+	stats->heapLargest = largest;
+	stats->fragmentation = free ? 100 - (unsigned long)largest * 100 / free : 0;
+}
@@ -0,0 +1,69 @@
+/*
+  MemoryMonitor.h - stack and heap usage of the sketch
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#ifndef MemoryMonitor_h
+#define MemoryMonitor_h
+
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// Using memStats() fills the RAM above the variables with MEMORY_PAINT
+// before anything else runs. The stack overwrites it as it grows, so the
+// first byte not painted any more, searching up from the end of the heap,
+// tells how deep the stack has ever been.
+//
+// The heap is what malloc(), new and String take memory from. It grows up
+// from the end of the variables; the stack grows down from the end of
+// RAM. After the heap shrank, what it left behind counts as stack.
+
+#define MEMORY_PAINT 0xA5
+
+typedef struct {
+	unsigned int stackMax;	// deepest the stack has ever been, bytes
+	unsigned int unused;	// never touched between heap and stack
+	unsigned int heapSize;	// from the end of the variables to the heap end
+	unsigned int heapFree;	// freed and not reused inside the heap
+	unsigned int heapLargest;	// largest of these freed blocks
+	uint8_t fragmentation;	// per cent of heapFree not in the largest block
+} MemStats;
+
+void memStats(MemStats *stats);
+
+// Checks once per timer0 overflow, from the timer0 compare A interrupt,
+// that the stack stays at least margin bytes away from the heap. If it
+// came closer, memoryOverflow() is called, if the sketch defines it, and
+// the processor halts with interrupts disabled. memoryOverflow() runs
+// with interrupts disabled and the stack almost full; it should switch
+// off what must not stay on and return.
+void memoryGuardBegin(unsigned int margin);
+void memoryGuardEnd(void);
+void memoryOverflow(void) __attribute__((weak));
+// follows the heap end with the guard; called by the core from the main
+// loop and from delay()
+void memoryGuardService(void) __attribute__((weak));
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
@@ -0,0 +1,120 @@
+/*
+  Profiler.cpp - execution time statistics for the core's interrupts and loop()
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#include "Arduino.h"
+#include "Profiler.h"
+
+#if defined(PROFILER)
+
+extern "C" volatile unsigned long timer0_overflow_count;
+
+ProfileEntry profileTable[PROFILER_SLOTS];
+volatile uint16_t profileLatest[PROFILER_SLOTS];
+uint32_t profileLongSlots;
+
+uint16_t profilerTicks(void)
+{
+  uint8_t oldSREG = SREG;
+  uint8_t high, low;
+
+  cli();
+  high = timer0_overflow_count;
+  low = TCNT0;
+#ifdef TIFR0
+  if ((TIFR0 & _BV(TOV0)) && low < 255)
+#else
+  if ((TIFR & _BV(TOV0)) && low < 255)
+#endif
+    high++;
+  SREG = oldSREG;
+
+  return ((uint16_t)high << 8) | low;
+}
+
+void profilerReset(void)
+{
+  uint8_t oldSREG = SREG;
+
+  cli();
+  memset(profileTable, 0, sizeof(profileTable));
+  memset((void *)profileLatest, 0, sizeof(profileLatest));
+  SREG = oldSREG;
+}
+
+void profilerService(void)
+{
+  for (uint8_t i = 0; i < PROFILER_SLOTS; i++) {
+    uint8_t oldSREG = SREG;
+    uint16_t cycles;
+
+    cli();
+    cycles = profileLatest[i];
+    profileLatest[i] = 0;
+    SREG = oldSREG;
+
+    if (cycles) profileRecord(i, cycles);
+  }
+}
+
+static const char profile_name_0[] PROGMEM = "TIMER0_OVF";
+static const char profile_name_1[] PROGMEM = "Serial RX";
+static const char profile_name_2[] PROGMEM = "Serial UDRE";
+static const char profile_name_3[] PROGMEM = "Serial1 RX";
+static const char profile_name_4[] PROGMEM = "Serial1 UDRE";
+static const char profile_name_5[] PROGMEM = "ADC";
+static const char profile_name_6[] PROGMEM = "tone";
+static const char profile_name_7[] PROGMEM = "loop()";
+
+static const char * const profile_names[PROFILE_USER] PROGMEM = {
+  profile_name_0, profile_name_1, profile_name_2, profile_name_3,
+  profile_name_4, profile_name_5, profile_name_6, profile_name_7,
+};
+
+void profilerDump(Print &out)
+{
+  profilerService();
+
+  for (uint8_t i = 0; i < PROFILER_SLOTS; i++) {
+    const ProfileEntry &e = profileTable[i];
+    // timer0 ticks of 64 cycles, or cycles
+    uint8_t unit = (profileLongSlots & (1UL << i)) ? 64 : 1;
+
+    if (e.count == 0) continue;
+
+    if (i < PROFILE_USER) {
+      out.print((const __FlashStringHelper *)pgm_read_word(&profile_names[i]));
+    } else {
+      out.print(F("user "));
+      out.print(i - PROFILE_USER);
+    }
+    out.print(F(": n="));
+    out.print(e.count);
+    out.print(F(" min="));
+    out.print((unsigned long)e.min * unit);
+    out.print(F(" mean="));
+    // split, as sum * 64 may not fit in 32 bits
+    out.print((e.sum / e.count) * unit + (e.sum % e.count) * unit / e.count);
+    out.print(F(" max="));
+    out.print((unsigned long)e.max * unit);
+    out.println(F(" cycles"));
+  }
+}
+
+#endif
@@ -0,0 +1,170 @@
+/*
+  Profiler.h - execution time statistics for the core's interrupts and loop()
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#ifndef Profiler_h
+#define Profiler_h
+
+#include <inttypes.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+// Uncomment to have the core measure how long its interrupt handlers and
+// each pass of loop() take. This has to be set here (or with -DPROFILER
+// for core and sketch alike), not in the sketch, as the core is compiled
+// on its own. Print the results with
+//
+//   profilerDump(Serial);
+//
+// Interrupt handlers are timed in clock cycles with Timer1, which counts
+// every cycle while the profiler is built in. It runs in fast PWM mode
+// with TOP = 0xFFFF then, so analogWrite() on its pins still works, at
+// 244 Hz (16 MHz) or 305 Hz (20 MHz). tone() leaves it alone, while the
+// step engine, pulse capture and analogWriteConfig() on its pins refuse
+// to run.
+//
+// To keep the cost to a handler at a few cycles, PROFILE_ISR_END() only
+// stores the cycles of the run for its slot. profilerService(), called
+// after each pass of loop(), adds them to the table. So each slot counts
+// the latest run per pass of loop(); runs in between are left out. Only
+// the handler body is measured: the register saving of the vector and
+// the cycles to store the result are not. What the profiler adds to each
+// handler is checked with "make overhead" in tools/sim-core.
+//
+// Sketches may measure their own code, outside interrupt handlers, with
+// the PROFILE_USER slots:
+//
+//   PROFILE_BEGIN();
+//   ... at most 65535 cycles ...
+//   PROFILE_END(PROFILE_USER + 0);
+//
+// PROFILE_LONG_BEGIN()/PROFILE_LONG_END() take up to 4 million cycles,
+// in steps of 64, counted by Timer0.
+
+//#define PROFILER
+
+#define PROFILE_TIMER0_OVF	0
+#define PROFILE_SERIAL_RX	1
+#define PROFILE_SERIAL_UDRE	2
+#define PROFILE_SERIAL1_RX	3
+#define PROFILE_SERIAL1_UDRE	4
+#define PROFILE_ADC		5
+#define PROFILE_TONE		6
+#define PROFILE_LOOP		7
+#define PROFILE_USER		8
+
+#ifndef PROFILER_USER_SLOTS
+#define PROFILER_USER_SLOTS 4
+#endif
+#define PROFILER_SLOTS (PROFILE_USER + PROFILER_USER_SLOTS)
+
+#if defined(PROFILER)
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+typedef struct {
+	uint16_t count;	// saturates, min and max are kept up to date anyway
+	uint16_t min;	// in clock cycles, or 64 cycle ticks for PROFILE_LONG_*
+	uint16_t max;
+	uint32_t sum;
+} ProfileEntry;
+
+extern ProfileEntry profileTable[PROFILER_SLOTS];
+// cycles of the latest run of an interrupt handler, 0 once taken
+extern volatile uint16_t profileLatest[PROFILER_SLOTS];
+// bit n set: slot n is in timer0 ticks
+extern uint32_t profileLongSlots;
+
+#if PROFILER_SLOTS > 32
+#error "PROFILER_USER_SLOTS is too large"
+#endif
+
+// timer0 ticks, extended to 16 bits with its overflow count
+uint16_t profilerTicks(void);
+void profilerReset(void);
+// adds the runs of interrupt handlers to the table
+void profilerService(void);
+
+// Timer1, read with interrupts disabled, as handlers read it as well and
+// a 16 bit read in between would mix up its high byte
+static inline uint16_t profilerCycles(void) __attribute__((always_inline));
+static inline uint16_t profilerCycles(void)
+{
+	uint8_t oldSREG = SREG;
+	cli();
+	uint16_t t = TCNT1;
+	SREG = oldSREG;
+	return t;
+}
+
+static inline void profileRecord(uint8_t slot, uint16_t value) __attribute__((always_inline));
+static inline void profileRecord(uint8_t slot, uint16_t value)
+{
+	ProfileEntry *e = &profileTable[slot];
+
+	if (value < e->min || e->count == 0) e->min = value;
+	if (value > e->max) e->max = value;
+	if (e->count != 0xFFFF) {
+		e->count++;
+		e->sum += value;
+	}
+}
+
+#ifdef __cplusplus
+} // extern "C"
+
+#include "Print.h"
+
+// one line per slot used: runs, min, mean and max in clock cycles
+void profilerDump(Print &out);
+#endif
+
+// in interrupt handlers, with interrupts disabled; the run never takes
+// 0 cycles, so it can't be mistaken for a taken one
+#define PROFILE_ISR_BEGIN() uint16_t profile_start = TCNT1
+#define PROFILE_ISR_END(slot) (profileLatest[(slot)] = TCNT1 - profile_start)
+#define PROFILE_BEGIN() uint16_t profile_start = profilerCycles()
+#define PROFILE_END(slot) profileRecord((slot), profilerCycles() - profile_start)
+#define PROFILE_LONG_BEGIN() uint16_t profile_long_start = profilerTicks()
+#define PROFILE_LONG_END(slot) do { \
+		profileLongSlots |= 1UL << (slot); \
+		profileRecord((slot), profilerTicks() - profile_long_start); \
+	} while (0)
+
+#else
+
+#define PROFILE_ISR_BEGIN()
+#define PROFILE_ISR_END(slot)
+#define PROFILE_BEGIN()
+#define PROFILE_END(slot)
+#define PROFILE_LONG_BEGIN()
+#define PROFILE_LONG_END(slot)
+
+static inline void profilerReset(void) {}
+static inline void profilerService(void) {}
+#ifdef __cplusplus
+class Print;
+static inline void profilerDump(Print &) {}
+#endif
+
+#endif
+
+#endif
@@ -0,0 +1,121 @@
+/*
+  Scheduler.c - cooperative task scheduler for the Arduino main loop
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#include "wiring_private.h"
+#include "Scheduler.h"
+
+static Task *scheduler_tasks;
+static uint8_t scheduler_count;
+static uint8_t scheduler_running;	// against re-entry through delay()
+static unsigned long scheduler_window;	// millis() the load window started
+static unsigned int scheduler_load;
+
+void schedulerBegin(Task *tasks, uint8_t count)
+{
+	unsigned long now = millis();
+	uint8_t i;
+
+	for (i = 0; i < count; i++) {
+		tasks[i].due = now;
+		tasks[i].runs = tasks[i].misses = 0;
+		tasks[i].maxTime = tasks[i].windowTime = 0;
+		tasks[i].load = 0;
+	}
+	scheduler_window = now;
+	scheduler_load = 0;
+	scheduler_tasks = tasks;
+	scheduler_count = count;
+}
+
+void schedulerEnd(void)
+{
+	scheduler_count = 0;
+}
+
+unsigned int schedulerLoad(void)
+{
+	return scheduler_load;
+}
+
+static void schedulerUpdateLoad(unsigned long now)
+{
+	unsigned long total = 0;
+	uint8_t i;
+
+	if (now - scheduler_window < SCHEDULER_LOAD_WINDOW) return;
+
+	// microseconds per millisecond of window are per mille
+	unsigned long window = now - scheduler_window;
+	for (i = 0; i < scheduler_count; i++) {
+		Task *t = &scheduler_tasks[i];
+		t->load = t->windowTime / window;
+		total += t->windowTime;
+		t->windowTime = 0;
+	}
+	scheduler_load = total / window;
+	scheduler_window = now;
+}
+
+uint8_t schedulerRun(void)
+{
+	unsigned long now, start, time;
+	Task *next = 0;
+	unsigned long nextDeadline = 0;
+	uint8_t i;
+
+	if (scheduler_running || scheduler_count == 0) return 0;
+	scheduler_running = 1;
+
+	now = millis();
+	schedulerUpdateLoad(now);
+
+	for (i = 0; i < scheduler_count; i++) {
+		Task *t = &scheduler_tasks[i];
+		unsigned long deadline;
+
+		if ((long)(now - t->due) < 0) continue;
+		deadline = t->due + (t->deadline ? t->deadline : t->period);
+		if (next == 0 || t->priority < next->priority ||
+		    (t->priority == next->priority &&
+		     (long)(deadline - nextDeadline) < 0)) {
+			next = t;
+			nextDeadline = deadline;
+		}
+	}
+
+	if (next) {
+		if ((long)(now - nextDeadline) > 0) next->misses++;
+
+		start = micros();
+		next->run();
+		time = micros() - start;
+
+		next->runs++;
+		next->windowTime += time;
+		if (time > next->maxTime) next->maxTime = time;
+
+		// keep the rhythm, unless we're more than a period behind
+		next->due += next->period;
+		if ((long)(now - next->due) >= 0) next->due = now + next->period;
+	}
+
+	scheduler_running = 0;
+	return next != 0;
+}
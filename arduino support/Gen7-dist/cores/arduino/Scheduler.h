@@ -0,0 +1,78 @@
+/*
+  Scheduler.h - cooperative task scheduler for the Arduino main loop
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#ifndef Scheduler_h
+#define Scheduler_h
+
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// Periodic tasks, run one at a time from the main loop after loop() and
+// from delay() while it waits. There is no tick interrupt, time is taken
+// from millis(). Tasks must return quickly; a task calling delay() doesn't
+// run other tasks meanwhile.
+//
+//   Task tasks[] = {
+//     TASK(heaterControl, 100, 0, 50),
+//     TASK(reportStatus, 1000, 1, 0),
+//   };
+//   void setup() { schedulerBegin(tasks, 2); }
+//
+// When several tasks are due, the one with the lowest priority number
+// runs first, on equal priority the one with the earliest deadline.
+
+// length of the window the load figures are measured over
+#ifndef SCHEDULER_LOAD_WINDOW
+#define SCHEDULER_LOAD_WINDOW 1000	// ms
+#endif
+
+typedef struct {
+	void (*run)(void);
+	unsigned long period;	// ms between runs
+	uint8_t priority;	// 0 is the most urgent
+	unsigned int deadline;	// ms a run may start late, 0 means one period
+
+	// maintained by the scheduler
+	unsigned long due;	// millis() of the next run
+	unsigned long runs;
+	unsigned long misses;	// runs started after their deadline
+	unsigned long maxTime;	// longest run, us
+	unsigned long windowTime;	// us used in the current load window
+	unsigned int load;	// share of the CPU in the last window, per mille
+} Task;
+
+#define TASK(function, period, priority, deadline) \
+	{ (function), (period), (priority), (deadline), 0, 0, 0, 0, 0, 0 }
+
+void schedulerBegin(Task *tasks, uint8_t count);
+void schedulerEnd(void);
+// runs the most urgent due task, if any; returns 1 if one ran
+uint8_t schedulerRun(void) __attribute__((weak));
+// per mille of CPU time used by all tasks in the last window
+unsigned int schedulerLoad(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
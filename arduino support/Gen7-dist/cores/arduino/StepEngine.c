@@ -0,0 +1,222 @@
+/*
+  StepEngine.c - interrupt driven stepper pulse generation on Timer1
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#include "wiring_private.h"
+#include "StepEngine.h"
+
+#if defined(TIMER1_COMPA_vect) && defined(WGM12)
+
+#define QUEUE_MASK (STEP_ENGINE_QUEUE - 1)
+
+static StepSegment step_queue[STEP_ENGINE_QUEUE];
+static volatile uint8_t step_head;	// written by the main loop
+static volatile uint8_t step_tail;	// written by the interrupt
+static volatile uint8_t step_running;
+
+static PinGroup step_pins, dir_pins;
+static uint8_t step_axes;
+static uint8_t step_saved_tccr1a, step_saved_tccr1b, step_saved_timsk1;
+// PWM duties and the TOP analogWriteConfig() may have put into ICR1
+static uint16_t step_saved_ocr1a, step_saved_ocr1b, step_saved_icr1;
+
+// state of the segment being played
+static StepSegment *step_segment;
+static uint16_t step_left;
+static int16_t step_error[STEP_ENGINE_AXES];
+
+// port bits to raise on the next interrupt, one entry per port of
+// step_pins, and all step bits per port to lower again
+static uint8_t step_next[PIN_GROUP_MAX_PORTS];
+static uint8_t step_all[PIN_GROUP_MAX_PORTS];
+
+uint8_t stepEngineBegin(const uint8_t *stepPins, const uint8_t *dirPins, uint8_t axes)
+{
+	uint8_t i;
+
+#if defined(PROFILER)
+	return 0;	// Timer1 is the profiler's time base
+#endif
+	if (axes == 0 || axes > STEP_ENGINE_AXES) return 0;
+	if (!pinGroupInit(&step_pins, stepPins, axes)) return 0;
+	if (!pinGroupInit(&dir_pins, dirPins, axes)) return 0;
+	step_axes = axes;
+
+	for (i = 0; i < PIN_GROUP_MAX_PORTS; i++) {
+		step_next[i] = 0;
+		step_all[i] = i < step_pins.ports ? step_pins.portMask[i] : 0;
+	}
+	step_head = step_tail = 0;
+	step_segment = 0;
+	step_running = 0;
+
+	uint8_t oldSREG = SREG;
+	cli();
+	step_saved_tccr1a = TCCR1A;
+	step_saved_tccr1b = TCCR1B;
+	step_saved_timsk1 = TIMSK1;
+	step_saved_ocr1a = OCR1A;
+	step_saved_ocr1b = OCR1B;
+	step_saved_icr1 = ICR1;
+	TIMSK1 = 0;
+	TCCR1A = 0;
+	TCCR1B = (1 << WGM12) | (1 << CS11);	// CTC with TOP = OCR1A, F_CPU / 8
+	SREG = oldSREG;
+
+	return 1;
+}
+
+void stepEngineEnd(void)
+{
+	stepEngineStop();
+#if defined(PROFILER)
+	return;
+#endif
+
+	uint8_t oldSREG = SREG;
+	cli();
+	TIMSK1 = step_saved_timsk1;
+	// stopped while the values go back, so no compare fires in between
+	TCCR1B = 0;
+	OCR1A = step_saved_ocr1a;
+	OCR1B = step_saved_ocr1b;
+	ICR1 = step_saved_icr1;
+	TCNT1 = 0;
+	TIFR1 = (1 << OCF1A) | (1 << OCF1B) | (1 << TOV1);
+	TCCR1A = step_saved_tccr1a;
+	TCCR1B = step_saved_tccr1b;
+	SREG = oldSREG;
+}
+
+uint8_t stepEngineQueueFree(void)
+{
+	return QUEUE_MASK - ((step_head - step_tail) & QUEUE_MASK);
+}
+
+uint8_t stepEngineBusy(void)
+{
+	return step_running;
+}
+
+uint8_t stepEngineQueue(const StepSegment *segment)
+{
+	uint8_t head = step_head;
+
+#if defined(PROFILER)
+	return 0;
+#endif
+	// the Bresenham errors are 16 bit signed
+	if (segment->events == 0 || segment->events > 32767) return 0;
+	if (((head + 1) & QUEUE_MASK) == step_tail) return 0;
+	step_queue[head] = *segment;
+	step_head = (head + 1) & QUEUE_MASK;
+
+	if (!step_running) {
+		uint8_t oldSREG = SREG;
+		cli();
+		// the first interrupt only fetches the segment and computes the
+		// first event, so it doesn't matter when it comes
+		step_running = 1;
+		TCNT1 = 0;
+		OCR1A = 100;
+		TIFR1 = (1 << OCF1A);
+		TIMSK1 |= (1 << OCIE1A);
+		SREG = oldSREG;
+	}
+	return 1;
+}
+
+void stepEngineStop(void)
+{
+	uint8_t i, oldSREG = SREG;
+
+	cli();
+	TIMSK1 &= ~(1 << OCIE1A);
+	step_running = 0;
+	step_segment = 0;
+	step_tail = step_head;
+	for (i = 0; i < step_pins.ports; i++) {
+		*step_pins.out[i] &= ~step_all[i];
+		step_next[i] = 0;
+	}
+	SREG = oldSREG;
+}
+
+ISR(TIMER1_COMPA_vect)
+{
+	uint8_t i, mask = 0, raised = 0, ports = step_pins.ports;
+
+	// raise the edges computed last time first, so they come at a fixed
+	// time after the compare match, whatever the work below takes
+	for (i = 0; i < ports; i++) {
+		if (step_next[i]) *step_pins.out[i] |= step_next[i];
+		raised |= step_next[i];
+	}
+
+	if (step_segment == 0) {
+		if (step_tail == step_head) {
+			if (raised) {
+				// the last steps of the queue; there's no work to keep
+				// them high meanwhile, so they end on the next compare
+				for (i = 0; i < ports; i++) step_next[i] = 0;
+				return;
+			}
+			// nothing left, lower the pins and stop
+			for (i = 0; i < ports; i++) {
+				*step_pins.out[i] &= ~step_all[i];
+				step_next[i] = 0;
+			}
+			TIMSK1 &= ~(1 << OCIE1A);
+			step_running = 0;
+			return;
+		}
+		step_segment = &step_queue[step_tail];
+		step_left = step_segment->events;
+		for (i = 0; i < step_axes; i++)
+			step_error[i] = -(int16_t)(step_left >> 1);
+		// set up now, there's one interval until the first step edge
+		pinGroupWrite(&dir_pins, 0xFF, step_segment->direction);
+		OCR1A = step_segment->interval - 1;
+	}
+
+	// one Bresenham step for the next event
+	for (i = 0; i < step_axes; i++) {
+		step_error[i] += step_segment->steps[i];
+		if (step_error[i] > 0) {
+			step_error[i] -= step_segment->events;
+			mask |= 1 << i;
+		}
+	}
+	if (--step_left == 0) {
+		step_segment = 0;
+		step_tail = (step_tail + 1) & QUEUE_MASK;
+	}
+
+	for (i = 0; i < ports; i++) step_next[i] = 0;
+	for (i = 0; i < step_axes; i++) {
+		if (mask & (1 << i)) step_next[step_pins.pinPort[i]] |= step_pins.pinMask[i];
+	}
+
+	// end the pulses; the work above kept them high for a few microseconds
+	for (i = 0; i < ports; i++) {
+		*step_pins.out[i] &= ~step_all[i];
+	}
+}
+
+#endif
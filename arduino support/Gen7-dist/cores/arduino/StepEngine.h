@@ -0,0 +1,72 @@
+/*
+  StepEngine.h - interrupt driven stepper pulse generation on Timer1
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#ifndef StepEngine_h
+#define StepEngine_h
+
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// The main loop queues straight line segments, the Timer1 compare
+// interrupt plays them: every interval it does one Bresenham step for
+// all axes and pulses the step pins of the axes which move. Step pins
+// sharing a port get their edges in the same cycle.
+//
+// Timer1 runs in CTC mode at F_CPU / 8 while the engine is active, so
+// analogWrite() on its pins doesn't work and pulseCaptureBegin() can't
+// be used. stepEngineEnd() hands the timer back. With the profiler built
+// in (Profiler.h), Timer1 is its time base and stepEngineBegin() fails.
+
+#ifndef STEP_ENGINE_AXES
+#define STEP_ENGINE_AXES 4
+#endif
+// must be a power of two
+#ifndef STEP_ENGINE_QUEUE
+#define STEP_ENGINE_QUEUE 8
+#endif
+
+// timer ticks per microsecond, 2 at 16 MHz, 2.5 at 20 MHz
+#define STEP_ENGINE_TICKS(us) ((uint16_t)((us) * (F_CPU / 8 / 1000L) / 1000L))
+
+typedef struct {
+	uint16_t interval;	// timer ticks between events, at least 100
+	uint16_t events;	// number of events, 1 to 32767
+	uint16_t steps[STEP_ENGINE_AXES];	// steps per axis, up to events
+	uint8_t direction;	// level of the direction pin of axis n in bit n
+} StepSegment;
+
+// step and direction pins have to be outputs already
+uint8_t stepEngineBegin(const uint8_t *stepPins, const uint8_t *dirPins, uint8_t axes);
+void stepEngineEnd(void);
+// returns 0 if the queue is full or events is outside 1 to 32767
+uint8_t stepEngineQueue(const StepSegment *segment);
+uint8_t stepEngineQueueFree(void);
+uint8_t stepEngineBusy(void);
+// drops all queued segments and stops at once
+void stepEngineStop(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
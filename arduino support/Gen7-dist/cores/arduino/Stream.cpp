@@ -22,9 +22,11 @@
 
 #include "Arduino.h"
 #include "Stream.h"
+#include "FixedString.h"
 
 #define PARSE_TIMEOUT 1000  // default number of milli-seconds to wait
 #define NO_SKIP_CHAR  1  // a magic char not found in a valid ASCII numeric field
+#define MANTISSA_LIMIT 100000000UL  // below this, one more digit fits into an unsigned long
 
 // private method to read stream with timeout
 int Stream::timedRead()
@@ -64,6 +66,63 @@ int Stream::peekNextDigit()
   }
 }
 
+// reads a number with optional sign and decimal point, starting at the
+// next digit in the stream. The significant digits are accumulated as an
+// integer, the return value is the decimal exponent to apply to it.
+// Digits beyond what fits into the mantissa only move the exponent.
+int Stream::parseMantissa(char skipChar, unsigned long &mantissa, boolean &isNegative)
+{
+  boolean isFraction = false;
+  int exponent = 0;
+  int c;
+
+  mantissa = 0;
+  isNegative = false;
+
+  c = peekNextDigit();
+  // ignore non numeric leading characters
+  if(c < 0)
+    return 0; // zero returned if timeout
+
+  do{
+    if(c == skipChar)
+      ; // ignore
+    else if(c == '-')
+      isNegative = true;
+    else if (c == '.')
+      isFraction = true;
+    else if(c >= '0' && c <= '9') {      // is c a digit?
+      if (mantissa < MANTISSA_LIMIT) {
+        mantissa = mantissa * 10 + c - '0';
+        if(isFraction)
+          exponent--;
+      }
+      else if(!isFraction)
+        exponent++;
+    }
+    read();  // consume the character we got with peek
+    c = timedPeek();
+  }
+  while( (c >= '0' && c <= '9')  || c == '.' || c == skipChar );
+
+  return exponent;
+}
+
+// 10^n as float, using integer multiplications for the common small n
+static float powerOfTen(int n)
+{
+  float result = 1.0;
+  unsigned long p = 1;
+
+  while (n > 9) {
+    result *= 1e9;
+    n -= 9;
+  }
+  while (n-- > 0)
+    p *= 10;
+  return result * p;
+}
+
 // Public Methods
 //////////////////////////////////////////////////////////////
 
@@ -172,41 +231,57 @@ float Stream::parseFloat()
 
 // as above but the given skipChar is ignored
 // this allows format characters (typically commas) in values to be ignored
-float Stream::parseFloat(char skipChar){
-  boolean isNegative = false;
-  boolean isFraction = false;
-  long value = 0;
-  char c;
-  float fraction = 1.0;
+float Stream::parseFloat(char skipChar)
+{
+  unsigned long mantissa;
+  boolean isNegative;
+  int exponent = parseMantissa(skipChar, mantissa, isNegative);
+  float value = mantissa;
+
+  // a single scaling at the end instead of one multiplication per digit,
+  // which is both faster and rounds only once
+  if (exponent < 0)
+    value /= powerOfTen(-exponent);
+  else if (exponent > 0)
+    value *= powerOfTen(exponent);
 
-  c = peekNextDigit();
-    // ignore non numeric leading characters
-  if(c < 0)
-    return 0; // zero returned if timeout
+  if(isNegative)
+    value = -value;
+  return value;
+}
 
-  do{
-    if(c == skipChar)
-      ; // ignore
-    else if(c == '-')
-      isNegative = true;
-    else if (c == '.')
-      isFraction = true;
-    else if(c >= '0' && c <= '9')  {      // is c a digit?
-      value = value * 10 + c - '0';
-      if(isFraction)
-         fraction *= 0.1;
-    }
-    read();  // consume the character we got with peek
-    c = timedPeek();
+// as parseFloat, but returns the value multiplied by 10^decimals as long,
+// rounded half away from zero. Uses integer math only.
+long Stream::parseFixed(uint8_t decimals)
+{
+  return parseFixed(decimals, NO_SKIP_CHAR);
+}
+
+// as above but the given skipChar is ignored
+long Stream::parseFixed(uint8_t decimals, char skipChar)
+{
+  unsigned long mantissa;
+  boolean isNegative;
+  int exponent = parseMantissa(skipChar, mantissa, isNegative) + decimals;
+
+  if (exponent < -9) {
+    mantissa = 0;
+  }
+  else if (exponent < 0) {
+    unsigned long divisor = 1;
+    while (exponent++ < 0)
+      divisor *= 10;
+    mantissa = (mantissa + divisor / 2) / divisor;
+  }
+  else {
+    // values out of range for a long overflow, as with parseInt()
+    while (exponent-- > 0)
+      mantissa *= 10;
   }
-  while( (c >= '0' && c <= '9')  || c == '.' || c == skipChar );
 
   if(isNegative)
-    value = -value;
-  if(isFraction)
-    return value * fraction;
-  else
-    return value;
+    return -(long)mantissa;
+  return mantissa;
 }
 
 // read characters from stream into buffer
@@ -244,6 +319,24 @@ size_t Stream::readBytesUntil(char terminator, char *buffer, size_t length)
   return index; // return number of characters, not including null terminator
 }
 
+// readBytes() and readBytesUntil() into a FixedString, replacing its
+// previous contents. No heap memory is used.
+size_t Stream::readBytes(FixedStringBase &str)
+{
+  size_t n = readBytes(str.wbuffer(), str.cap);
+  str.len = n;
+  str.wbuffer()[n] = 0;
+  return n;
+}
+
+size_t Stream::readBytesUntil(char terminator, FixedStringBase &str)
+{
+  size_t n = readBytesUntil(terminator, str.wbuffer(), str.cap);
+  str.len = n;
+  str.wbuffer()[n] = 0;
+  return n;
+}
+
 String Stream::readString()
 {
   String ret;
@@ -25,6 +25,8 @@
 #include <inttypes.h>
 #include "Print.h"
 
+class FixedStringBase;
+
 // compatability macros for testing
 /*
 #define   getInt()            parseInt()
@@ -43,6 +45,8 @@ class Stream : public Print
     int timedRead();    // private method to read stream with timeout
     int timedPeek();    // private method to peek stream with timeout
     int peekNextDigit(); // returns the next numeric digit in the stream or -1 if timeout
+    int parseMantissa(char skipChar, unsigned long &mantissa, boolean &isNegative);
+    // reads a decimal number as integer mantissa, returns its decimal exponent
 
   public:
     virtual int available() = 0;
@@ -73,6 +77,9 @@ class Stream : public Print
 
   float parseFloat();               // float version of parseInt
 
+  long parseFixed(uint8_t decimals); // fixed point version of parseFloat, no floating point math involved
+  // returns the value multiplied by 10^decimals, rounded, e.g. "12.3456" with 3 decimals gives 12346
+
   size_t readBytes( char *buffer, size_t length); // read chars from stream into buffer
   // terminates if length characters have been read or timeout (see setTimeout)
   // returns the number of characters placed in the buffer (0 means no valid data found)
@@ -81,6 +88,10 @@ class Stream : public Print
   // terminates if length characters have been read, timeout, or if the terminator character  detected
   // returns the number of characters placed in the buffer (0 means no valid data found)
 
+  size_t readBytes(FixedStringBase &str); // as readBytes, but fills str up to its capacity
+  size_t readBytesUntil(char terminator, FixedStringBase &str); // as above with terminator character
+  // these never allocate memory, the result is always null terminated
+
   // Arduino String functions to be added here
   String readString();
   String readStringUntil(char terminator);
@@ -91,6 +102,8 @@ class Stream : public Print
   // this allows format characters (typically commas) in values to be ignored
 
   float parseFloat(char skipChar);  // as above but the given skipChar is ignored
+
+  long parseFixed(uint8_t decimals, char skipChar); // as above but the given skipChar is ignored
 };
 
 #endif
@@ -0,0 +1,46 @@
+/*
+  Thermistor.c - table based thermistor temperature conversion
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#include "Thermistor.h"
+
+uint16_t thermistorToTemp(const ThermistorEntry *table, uint8_t size, uint16_t adc)
+{
+	uint16_t base, temp, slope;
+	uint8_t i;
+
+	if (adc <= pgm_read_word(&table[0].adc))
+		return pgm_read_word(&table[0].temp);
+
+	// find the last entry at or below the reading
+	for (i = 1; i < size; i++) {
+		if (pgm_read_word(&table[i].adc) > adc) break;
+	}
+	if (i == size)
+		return pgm_read_word(&table[size - 1].temp);
+	i--;
+
+	base = pgm_read_word(&table[i].adc);
+	temp = pgm_read_word(&table[i].temp);
+	slope = pgm_read_word(&table[i].slope);
+
+	// the slope is precomputed, so this is a multiplication only
+	uint16_t drop = ((uint32_t)(adc - base) * slope) >> 8;
+	return drop < temp ? temp - drop : 0;
+}
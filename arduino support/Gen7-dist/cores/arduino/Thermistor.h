@@ -0,0 +1,51 @@
+/*
+  Thermistor.h - table based thermistor temperature conversion
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#ifndef Thermistor_h
+#define Thermistor_h
+
+#include <inttypes.h>
+#include <avr/pgmspace.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// One entry of a table made by tools/thermistor-table. Temperatures are
+// in quarter degrees Celsius, slope is the temperature drop per ADC step
+// towards the next entry, times 256. Entries are sorted by ADC reading.
+typedef struct {
+	uint16_t adc;
+	uint16_t temp;
+	uint16_t slope;
+} ThermistorEntry;
+
+#define THERMISTOR_DEGREES(quarters) ((quarters) >> 2)
+
+// Converts an ADC reading into quarter degrees Celsius by linear
+// interpolation in a table in PROGMEM. Readings outside the table
+// give the temperature of the nearest end.
+uint16_t thermistorToTemp(const ThermistorEntry *table, uint8_t size, uint16_t adc);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
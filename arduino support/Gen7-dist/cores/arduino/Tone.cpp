@@ -36,6 +36,7 @@ Version Modified By Date     Comments
 #include <avr/pgmspace.h>
 #include "Arduino.h"
 #include "pins_arduino.h"
+#include "Profiler.h"
 
 #if defined(TCCR2) // ATmega8, ATmega128 or similar
 #define TCCR2A TCCR2
@@ -49,41 +50,36 @@ Version Modified By Date     Comments
 #define TIMSK1 TIMSK
 #endif
 
-// timerx_toggle_count:
-//  > 0 - duration specified
-//  = 0 - stopped
-//  < 0 - infinitely (until stop() method called, or new play() called)
+// Each timer used for tones is a channel. A channel plays a note by
+// toggling its pin from the compare interrupt, counting the toggles
+// down, then fetches the next note from its queue. Notes are turned
+// into timer settings and toggle counts when queued, so the interrupt
+// does no arithmetic beyond a 16 bit decrement.
 
-#if defined(TIMSK0)
-volatile long timer0_toggle_count;
-volatile uint8_t *timer0_pin_port;
-volatile uint8_t timer0_pin_mask;
+#ifndef TONE_QUEUE
+#define TONE_QUEUE 4	// must be a power of two
 #endif
 
-volatile long timer1_toggle_count;
-volatile uint8_t *timer1_pin_port;
-volatile uint8_t timer1_pin_mask;
-volatile long timer2_toggle_count;
-volatile uint8_t *timer2_pin_port;
-volatile uint8_t timer2_pin_mask;
-
-#if defined(TIMSK3)
-volatile long timer3_toggle_count;
-volatile uint8_t *timer3_pin_port;
-volatile uint8_t timer3_pin_mask;
-#endif
-
-#if defined(TIMSK4)
-volatile long timer4_toggle_count;
-volatile uint8_t *timer4_pin_port;
-volatile uint8_t timer4_pin_mask;
-#endif
-
-#if defined(TIMSK5)
-volatile long timer5_toggle_count;
-volatile uint8_t *timer5_pin_port;
-volatile uint8_t timer5_pin_mask;
-#endif
+struct ToneNote {
+  uint16_t ocr;
+  uint8_t prescalarbits;
+  uint8_t silent;       // a rest: count, but don't toggle
+  uint16_t count;       // toggles, low 16 bits
+  uint16_t countHigh;   // further toggles in units of 65536
+  uint8_t forever;      // play until noTone() or the next tone()
+};
+
+struct ToneChannel {
+  volatile uint8_t *port;
+  uint8_t mask;
+  volatile uint8_t toggle;      // mask, or 0 during a rest
+  volatile uint16_t count;
+  volatile uint16_t countHigh;
+  volatile uint8_t forever;
+  ToneNote queue[TONE_QUEUE];
+  volatile uint8_t head;        // written by toneQueue()
+  volatile uint8_t tail;        // written by the interrupt
+};
 
 
 // Don't distinguish by chip type, but by register presence
@@ -91,6 +87,7 @@ volatile uint8_t timer5_pin_mask;
 
 #define AVAILABLE_TONE_PINS 1
 #define USE_TIMER2
+#define TIMER2_CHANNEL 0
 
 const uint8_t PROGMEM tone_pin_to_timer_PGM[] = { 2 /*, 3, 4, 5, 1, 0 */ };
 static uint8_t tone_pins[AVAILABLE_TONE_PINS] = { 255 /*, 255, 255, 255, 255, 255 */ };
@@ -99,6 +96,7 @@ static uint8_t tone_pins[AVAILABLE_TONE_PINS] = { 255 /*, 255, 255, 255, 255, 25
 
 #define AVAILABLE_TONE_PINS 1
 #define USE_TIMER2
+#define TIMER2_CHANNEL 0
 
 const uint8_t PROGMEM tone_pin_to_timer_PGM[] = { 2 /*, 1 */ };
 static uint8_t tone_pins[AVAILABLE_TONE_PINS] = { 255 /*, 255 */ };
@@ -107,14 +105,31 @@ static uint8_t tone_pins[AVAILABLE_TONE_PINS] = { 255 /*, 255 */ };
  
 #define AVAILABLE_TONE_PINS 1
 #define USE_TIMER3
+#define TIMER3_CHANNEL 0
  
 const uint8_t PROGMEM tone_pin_to_timer_PGM[] = { 3 /*, 1 */ };
 static uint8_t tone_pins[AVAILABLE_TONE_PINS] = { 255 /*, 255 */ };
  
+#elif defined(__AVR_ATmega644__) || defined(__AVR_ATmega644P__) || defined(__AVR_ATmega1284P__)
+
+// Timer 1 is used only while it's free: no PWM output connected and no
+// interrupt enabled, e.g. by the step engine or pulse capture. Its
+// interrupt is compare B, with OCR1B = 0 it fires once per CTC cycle;
+// compare A is left to Servo and the step engine.
+#define AVAILABLE_TONE_PINS 2
+#define USE_TIMER2
+#define TIMER2_CHANNEL 0
+#define USE_TIMER1
+#define TIMER1_CHANNEL 1
+
+const uint8_t PROGMEM tone_pin_to_timer_PGM[] = { 2, 1 };
+static uint8_t tone_pins[AVAILABLE_TONE_PINS] = { 255, 255 };
+
 #else
 
 #define AVAILABLE_TONE_PINS 1
 #define USE_TIMER2
+#define TIMER2_CHANNEL 0
 
 // Leave timer 0 to last.
 const uint8_t PROGMEM tone_pin_to_timer_PGM[] = { 2 /*, 1, 0 */ };
@@ -122,30 +137,57 @@ static uint8_t tone_pins[AVAILABLE_TONE_PINS] = { 255 /*, 255, 255 */ };
 
 #endif
 
+static ToneChannel tone_channels[AVAILABLE_TONE_PINS];
 
+#ifdef USE_TIMER1
+static uint8_t timer1_saved_tccr1a, timer1_saved_tccr1b;
+
+static bool timer1Free()
+{
+#if defined(PROFILER)
+  return false;	// the profiler's time base
+#endif
+  return TIMSK1 == 0 &&
+         (TCCR1A & ((1 << COM1A1) | (1 << COM1A0) | (1 << COM1B1) | (1 << COM1B0))) == 0;
+}
+#endif
 
+
+// Returns the channel for the pin, or -1 if all timers are busy.
 static int8_t toneBegin(uint8_t _pin)
 {
-  int8_t _timer = -1;
+  int8_t _channel = -1;
+  uint8_t _timer;
 
   // if we're already using the pin, the timer should be configured.  
   for (int i = 0; i < AVAILABLE_TONE_PINS; i++) {
     if (tone_pins[i] == _pin) {
-      return pgm_read_byte(tone_pin_to_timer_PGM + i);
+      return i;
     }
   }
   
   // search for an unused timer.
   for (int i = 0; i < AVAILABLE_TONE_PINS; i++) {
     if (tone_pins[i] == 255) {
+#ifdef USE_TIMER1
+      if (pgm_read_byte(tone_pin_to_timer_PGM + i) == 1 && !timer1Free())
+        continue;
+#endif
       tone_pins[i] = _pin;
-      _timer = pgm_read_byte(tone_pin_to_timer_PGM + i);
+      _channel = i;
       break;
     }
   }
   
-  if (_timer != -1)
+  if (_channel != -1)
   {
+    ToneChannel *c = &tone_channels[_channel];
+
+    c->port = portOutputRegister(digitalPinToPort(_pin));
+    c->mask = digitalPinToBitMask(_pin);
+    c->head = c->tail = 0;
+    _timer = pgm_read_byte(tone_pin_to_timer_PGM + _channel);
+
     // Set timer specific stuff
     // All timers in CTC mode
     // 8 bit timers will require changing prescalar values,
@@ -159,20 +201,21 @@ static int8_t toneBegin(uint8_t _pin)
         TCCR0B = 0;
         bitWrite(TCCR0A, WGM01, 1);
         bitWrite(TCCR0B, CS00, 1);
-        timer0_pin_port = portOutputRegister(digitalPinToPort(_pin));
-        timer0_pin_mask = digitalPinToBitMask(_pin);
         break;
       #endif
 
       #if defined(TCCR1A) && defined(TCCR1B) && defined(WGM12)
       case 1:
         // 16 bit timer
+        #ifdef USE_TIMER1
+        timer1_saved_tccr1a = TCCR1A;
+        timer1_saved_tccr1b = TCCR1B;
+        OCR1B = 0;
+        #endif
         TCCR1A = 0;
         TCCR1B = 0;
         bitWrite(TCCR1B, WGM12, 1);
         bitWrite(TCCR1B, CS10, 1);
-        timer1_pin_port = portOutputRegister(digitalPinToPort(_pin));
-        timer1_pin_mask = digitalPinToBitMask(_pin);
         break;
       #endif
 
@@ -183,8 +226,6 @@ static int8_t toneBegin(uint8_t _pin)
         TCCR2B = 0;
         bitWrite(TCCR2A, WGM21, 1);
         bitWrite(TCCR2B, CS20, 1);
-        timer2_pin_port = portOutputRegister(digitalPinToPort(_pin));
-        timer2_pin_mask = digitalPinToBitMask(_pin);
         break;
       #endif
 
@@ -195,8 +236,6 @@ static int8_t toneBegin(uint8_t _pin)
         TCCR3B = 0;
         bitWrite(TCCR3B, WGM32, 1);
         bitWrite(TCCR3B, CS30, 1);
-        timer3_pin_port = portOutputRegister(digitalPinToPort(_pin));
-        timer3_pin_mask = digitalPinToBitMask(_pin);
         break;
       #endif
 
@@ -213,8 +252,6 @@ static int8_t toneBegin(uint8_t _pin)
           bitWrite(TCCR4B, CS43, 1);
         #endif
         bitWrite(TCCR4B, CS40, 1);
-        timer4_pin_port = portOutputRegister(digitalPinToPort(_pin));
-        timer4_pin_mask = digitalPinToBitMask(_pin);
         break;
       #endif
 
@@ -225,203 +262,249 @@ static int8_t toneBegin(uint8_t _pin)
         TCCR5B = 0;
         bitWrite(TCCR5B, WGM52, 1);
         bitWrite(TCCR5B, CS50, 1);
-        timer5_pin_port = portOutputRegister(digitalPinToPort(_pin));
-        timer5_pin_mask = digitalPinToBitMask(_pin);
         break;
       #endif
     }
   }
 
-  return _timer;
+  return _channel;
 }
 
 
-
-// frequency (in hertz) and duration (in milliseconds).
-
-void tone(uint8_t _pin, unsigned int frequency, unsigned long duration)
+// Turns frequency (in hertz) and duration (in milliseconds) into timer
+// settings and a toggle count. A frequency of 0 makes a rest, timed
+// with a 1 kHz tick.
+static void toneCompute(uint8_t _timer, unsigned int frequency, unsigned long duration, ToneNote *note)
 {
   uint8_t prescalarbits = 0b001;
-  long toggle_count = 0;
   uint32_t ocr = 0;
-  int8_t _timer;
+  uint32_t toggle_count;
 
-  _timer = toneBegin(_pin);
+  note->silent = frequency == 0;
+  if (frequency == 0)
+    frequency = 1000;
 
-  if (_timer >= 0)
+  // if we are using an 8 bit timer, scan through prescalars to find the best fit
+  if (_timer == 0 || _timer == 2)
   {
-    // Set the pinMode as OUTPUT
-    pinMode(_pin, OUTPUT);
-    
-    // if we are using an 8 bit timer, scan through prescalars to find the best fit
-    if (_timer == 0 || _timer == 2)
+    ocr = F_CPU / frequency / 2 - 1;
+    prescalarbits = 0b001;  // ck/1: same for both timers
+    if (ocr > 255)
     {
-      ocr = F_CPU / frequency / 2 - 1;
-      prescalarbits = 0b001;  // ck/1: same for both timers
+      ocr = F_CPU / frequency / 2 / 8 - 1;
+      prescalarbits = 0b010;  // ck/8: same for both timers
+
+      if (_timer == 2 && ocr > 255)
+      {
+        ocr = F_CPU / frequency / 2 / 32 - 1;
+        prescalarbits = 0b011;
+      }
+
       if (ocr > 255)
       {
-        ocr = F_CPU / frequency / 2 / 8 - 1;
-        prescalarbits = 0b010;  // ck/8: same for both timers
+        ocr = F_CPU / frequency / 2 / 64 - 1;
+        prescalarbits = _timer == 0 ? 0b011 : 0b100;
 
         if (_timer == 2 && ocr > 255)
         {
-          ocr = F_CPU / frequency / 2 / 32 - 1;
-          prescalarbits = 0b011;
+          ocr = F_CPU / frequency / 2 / 128 - 1;
+          prescalarbits = 0b101;
         }
 
         if (ocr > 255)
         {
-          ocr = F_CPU / frequency / 2 / 64 - 1;
-          prescalarbits = _timer == 0 ? 0b011 : 0b100;
-
-          if (_timer == 2 && ocr > 255)
-          {
-            ocr = F_CPU / frequency / 2 / 128 - 1;
-            prescalarbits = 0b101;
-          }
-
+          ocr = F_CPU / frequency / 2 / 256 - 1;
+          prescalarbits = _timer == 0 ? 0b100 : 0b110;
           if (ocr > 255)
           {
-            ocr = F_CPU / frequency / 2 / 256 - 1;
-            prescalarbits = _timer == 0 ? 0b100 : 0b110;
-            if (ocr > 255)
-            {
-              // can't do any better than /1024
-              ocr = F_CPU / frequency / 2 / 1024 - 1;
-              prescalarbits = _timer == 0 ? 0b101 : 0b111;
-            }
+            // can't do any better than /1024
+            ocr = F_CPU / frequency / 2 / 1024 - 1;
+            prescalarbits = _timer == 0 ? 0b101 : 0b111;
           }
         }
       }
-
-#if defined(TCCR0B)
-      if (_timer == 0)
-      {
-        TCCR0B = prescalarbits;
-      }
-      else
-#endif
-#if defined(TCCR2B)
-      {
-        TCCR2B = prescalarbits;
-      }
-#else
-      {
-        // dummy place holder to make the above ifdefs work
-      }
-#endif
     }
-    else
+  }
+  else
+  {
+    // two choices for the 16 bit timers: ck/1 or ck/64
+    ocr = F_CPU / frequency / 2 - 1;
+
+    prescalarbits = 0b001;
+    if (ocr > 0xffff)
     {
-      // two choices for the 16 bit timers: ck/1 or ck/64
-      ocr = F_CPU / frequency / 2 - 1;
+      ocr = F_CPU / frequency / 2 / 64 - 1;
+      prescalarbits = 0b011;
+    }
+  }
 
-      prescalarbits = 0b001;
-      if (ocr > 0xffff)
-      {
-        ocr = F_CPU / frequency / 2 / 64 - 1;
-        prescalarbits = 0b011;
-      }
+  note->ocr = ocr;
+  note->prescalarbits = prescalarbits;
 
-      if (_timer == 1)
-      {
-#if defined(TCCR1B)
-        TCCR1B = (TCCR1B & 0b11111000) | prescalarbits;
-#endif
-      }
-#if defined(TCCR3B)
-      else if (_timer == 3)
-        TCCR3B = (TCCR3B & 0b11111000) | prescalarbits;
-#endif
-#if defined(TCCR4B)
-      else if (_timer == 4)
-        TCCR4B = (TCCR4B & 0b11111000) | prescalarbits;
-#endif
-#if defined(TCCR5B)
-      else if (_timer == 5)
-        TCCR5B = (TCCR5B & 0b11111000) | prescalarbits;
-#endif
+  // Calculate the toggle count
+  if (duration > 0)
+  {
+    toggle_count = 2UL * frequency * duration / 1000;
+    note->forever = 0;
+  }
+  else
+  {
+    toggle_count = 0x10000UL;
+    note->forever = 1;
+  }
+  note->count = toggle_count;
+  note->countHigh = toggle_count >> 16;
+}
 
-    }
-    
 
-    // Calculate the toggle count
-    if (duration > 0)
-    {
-      toggle_count = 2 * frequency * duration / 1000;
-    }
-    else
-    {
-      toggle_count = -1;
-    }
+// Applies a note to the channel's timer; called with interrupts disabled.
+static void toneStart(uint8_t _channel, const ToneNote *note)
+{
+  ToneChannel *c = &tone_channels[_channel];
+  uint8_t _timer = pgm_read_byte(tone_pin_to_timer_PGM + _channel);
 
-    // Set the OCR for the given timer,
-    // set the toggle count,
-    // then turn on the interrupts
-    switch (_timer)
-    {
+  *c->port &= ~c->mask;
+  c->toggle = note->silent ? 0 : c->mask;
+  c->count = note->count;
+  c->countHigh = note->countHigh;
+  c->forever = note->forever;
+
+  // Set the OCR for the given timer,
+  // then turn on the interrupts
+  switch (_timer)
+  {
 
 #if defined(OCR0A) && defined(TIMSK0) && defined(OCIE0A)
-      case 0:
-        OCR0A = ocr;
-        timer0_toggle_count = toggle_count;
-        bitWrite(TIMSK0, OCIE0A, 1);
-        break;
+    case 0:
+      TCCR0B = note->prescalarbits;
+      OCR0A = note->ocr;
+      bitWrite(TIMSK0, OCIE0A, 1);
+      break;
 #endif
 
-      case 1:
-#if defined(OCR1A) && defined(TIMSK1) && defined(OCIE1A)
-        OCR1A = ocr;
-        timer1_toggle_count = toggle_count;
-        bitWrite(TIMSK1, OCIE1A, 1);
+    case 1:
+#if defined(TCCR1B)
+      TCCR1B = (TCCR1B & 0b11111000) | note->prescalarbits;
+#endif
+#if defined(USE_TIMER1) && defined(OCIE1B)
+      OCR1A = note->ocr;
+      bitWrite(TIMSK1, OCIE1B, 1);
+#elif defined(OCR1A) && defined(TIMSK1) && defined(OCIE1A)
+      OCR1A = note->ocr;
+      bitWrite(TIMSK1, OCIE1A, 1);
 #elif defined(OCR1A) && defined(TIMSK) && defined(OCIE1A)
-        // this combination is for at least the ATmega32
-        OCR1A = ocr;
-        timer1_toggle_count = toggle_count;
-        bitWrite(TIMSK, OCIE1A, 1);
+      // this combination is for at least the ATmega32
+      OCR1A = note->ocr;
+      bitWrite(TIMSK, OCIE1A, 1);
 #endif
-        break;
+      break;
 
 #if defined(OCR2A) && defined(TIMSK2) && defined(OCIE2A)
-      case 2:
-        OCR2A = ocr;
-        timer2_toggle_count = toggle_count;
-        bitWrite(TIMSK2, OCIE2A, 1);
-        break;
+    case 2:
+#if defined(TCCR2B)
+      TCCR2B = note->prescalarbits;
+#endif
+      OCR2A = note->ocr;
+      bitWrite(TIMSK2, OCIE2A, 1);
+      break;
 #endif
 
 #if defined(TIMSK3)
-      case 3:
-        OCR3A = ocr;
-        timer3_toggle_count = toggle_count;
-        bitWrite(TIMSK3, OCIE3A, 1);
-        break;
+    case 3:
+      TCCR3B = (TCCR3B & 0b11111000) | note->prescalarbits;
+      OCR3A = note->ocr;
+      bitWrite(TIMSK3, OCIE3A, 1);
+      break;
 #endif
 
 #if defined(TIMSK4)
-      case 4:
-        OCR4A = ocr;
-        timer4_toggle_count = toggle_count;
-        bitWrite(TIMSK4, OCIE4A, 1);
-        break;
+    case 4:
+      TCCR4B = (TCCR4B & 0b11111000) | note->prescalarbits;
+      OCR4A = note->ocr;
+      bitWrite(TIMSK4, OCIE4A, 1);
+      break;
 #endif
 
 #if defined(OCR5A) && defined(TIMSK5) && defined(OCIE5A)
-      case 5:
-        OCR5A = ocr;
-        timer5_toggle_count = toggle_count;
-        bitWrite(TIMSK5, OCIE5A, 1);
-        break;
+    case 5:
+      TCCR5B = (TCCR5B & 0b11111000) | note->prescalarbits;
+      OCR5A = note->ocr;
+      bitWrite(TIMSK5, OCIE5A, 1);
+      break;
 #endif
 
+  }
+}
+
+
+// frequency (in hertz) and duration (in milliseconds).
+
+void tone(uint8_t _pin, unsigned int frequency, unsigned long duration)
+{
+  ToneNote note;
+  int8_t _channel;
+
+  _channel = toneBegin(_pin);
+
+  if (_channel >= 0)
+  {
+    // Set the pinMode as OUTPUT
+    pinMode(_pin, OUTPUT);
+
+    toneCompute(pgm_read_byte(tone_pin_to_timer_PGM + _channel), frequency, duration, &note);
+
+    uint8_t oldSREG = SREG;
+    cli();
+    // a new tone replaces anything queued
+    tone_channels[_channel].head = tone_channels[_channel].tail;
+    toneStart(_channel, &note);
+    SREG = oldSREG;
+  }
+}
+
+
+// Plays the note after the ones already queued for the pin, or right
+// away if the pin is silent. Returns false if the queue is full.
+bool toneQueue(uint8_t _pin, unsigned int frequency, unsigned long duration)
+{
+  for (int i = 0; i < AVAILABLE_TONE_PINS; i++) {
+    if (tone_pins[i] == _pin) {
+      ToneChannel *c = &tone_channels[i];
+      ToneNote note;
+      bool queued = false, full = false;
+
+      toneCompute(pgm_read_byte(tone_pin_to_timer_PGM + i), frequency, duration, &note);
+
+      // the interrupt frees the channel once its queue runs empty, so
+      // check it's still ours while adding the note
+      uint8_t oldSREG = SREG;
+      cli();
+      if (tone_pins[i] == _pin) {
+        uint8_t head = c->head;
+
+        if (((head + 1) & (TONE_QUEUE - 1)) == c->tail) {
+          full = true;
+        } else {
+          c->queue[head] = note;
+          c->head = (head + 1) & (TONE_QUEUE - 1);
+          queued = true;
+        }
+      }
+      SREG = oldSREG;
+
+      if (full)
+        return false;
+      if (queued)
+        return true;
+      break;	// the pin went silent meanwhile, start over
     }
   }
+
+  tone(_pin, frequency, duration);
+  return true;
 }
 
 
-// XXX: this function only works properly for timer 2 (the only one we use
-// currently).  for the others, it should end the tone, but won't restore
-// proper PWM functionality for the timer.
 void disableTimer(uint8_t _timer)
 {
   switch (_timer)
@@ -436,7 +519,15 @@ void disableTimer(uint8_t _timer)
 
 #if defined(TIMSK1) && defined(OCIE1A)
     case 1:
-      bitWrite(TIMSK1, OCIE1A, 0);
+      #if defined(USE_TIMER1) && defined(OCIE1B)
+        // we took it only when it was free, give it back as it was
+        bitWrite(TIMSK1, OCIE1B, 0);
+        TCCR1A = timer1_saved_tccr1a;
+        TCCR1B = timer1_saved_tccr1b;
+      #else
+        // XXX: this doesn't restore proper PWM functionality for the timer.
+        bitWrite(TIMSK1, OCIE1A, 0);
+      #endif
       break;
 #endif
 
@@ -492,42 +583,57 @@ void noTone(uint8_t _pin)
   digitalWrite(_pin, 0);
 }
 
-#ifdef USE_TIMER0
-ISR(TIMER0_COMPA_vect)
+
+// The work of all tone interrupts. _channel is a constant in each of
+// them, so this is inlined with the channel address folded in.
+static inline void toneInterrupt(uint8_t _channel) __attribute__((always_inline));
+static inline void toneInterrupt(uint8_t _channel)
 {
-  if (timer0_toggle_count != 0)
-  {
-    // toggle the pin
-    *timer0_pin_port ^= timer0_pin_mask;
+  ToneChannel *c = &tone_channels[_channel];
 
-    if (timer0_toggle_count > 0)
-      timer0_toggle_count--;
-  }
-  else
+  if (c->count == 0)
   {
-    disableTimer(0);
-    *timer0_pin_port &= ~(timer0_pin_mask);  // keep pin low after stop
+    if (c->countHigh == 0)
+    {
+      // note done, play the next one or stop
+      if (c->tail != c->head)
+      {
+        toneStart(_channel, &c->queue[c->tail]);
+        c->tail = (c->tail + 1) & (TONE_QUEUE - 1);
+      }
+      else
+      {
+        // need to call noTone() so that the tone_pins[] entry is reset, so the
+        // timer gets initialized next time we call tone().
+        noTone(tone_pins[_channel]);
+      }
+      return;
+    }
+    if (!c->forever)
+      c->countHigh--;
   }
+
+  // toggle the pin
+  *c->port ^= c->toggle;
+  c->count--;
+}
+
+#ifdef USE_TIMER0
+ISR(TIMER0_COMPA_vect)
+{
+  PROFILE_ISR_BEGIN();
+  toneInterrupt(TIMER0_CHANNEL);
+  PROFILE_ISR_END(PROFILE_TONE);
 }
 #endif
 
 
 #ifdef USE_TIMER1
-ISR(TIMER1_COMPA_vect)
+ISR(TIMER1_COMPB_vect)
 {
-  if (timer1_toggle_count != 0)
-  {
-    // toggle the pin
-    *timer1_pin_port ^= timer1_pin_mask;
-
-    if (timer1_toggle_count > 0)
-      timer1_toggle_count--;
-  }
-  else
-  {
-    disableTimer(1);
-    *timer1_pin_port &= ~(timer1_pin_mask);  // keep pin low after stop
-  }
+  PROFILE_ISR_BEGIN();
+  toneInterrupt(TIMER1_CHANNEL);
+  PROFILE_ISR_END(PROFILE_TONE);
 }
 #endif
 
@@ -535,24 +641,9 @@ ISR(TIMER1_COMPA_vect)
 #ifdef USE_TIMER2
 ISR(TIMER2_COMPA_vect)
 {
-
-  if (timer2_toggle_count != 0)
-  {
-    // toggle the pin
-    *timer2_pin_port ^= timer2_pin_mask;
-
-    if (timer2_toggle_count > 0)
-      timer2_toggle_count--;
-  }
-  else
-  {
-    // need to call noTone() so that the tone_pins[] entry is reset, so the
-    // timer gets initialized next time we call tone().
-    // XXX: this assumes timer 2 is always the first one used.
-    noTone(tone_pins[0]);
-//    disableTimer(2);
-//    *timer2_pin_port &= ~(timer2_pin_mask);  // keep pin low after stop
-  }
+  PROFILE_ISR_BEGIN();
+  toneInterrupt(TIMER2_CHANNEL);
+  PROFILE_ISR_END(PROFILE_TONE);
 }
 #endif
 
@@ -560,19 +651,9 @@ ISR(TIMER2_COMPA_vect)
 #ifdef USE_TIMER3
 ISR(TIMER3_COMPA_vect)
 {
-  if (timer3_toggle_count != 0)
-  {
-    // toggle the pin
-    *timer3_pin_port ^= timer3_pin_mask;
-
-    if (timer3_toggle_count > 0)
-      timer3_toggle_count--;
-  }
-  else
-  {
-    disableTimer(3);
-    *timer3_pin_port &= ~(timer3_pin_mask);  // keep pin low after stop
-  }
+  PROFILE_ISR_BEGIN();
+  toneInterrupt(TIMER3_CHANNEL);
+  PROFILE_ISR_END(PROFILE_TONE);
 }
 #endif
 
@@ -580,19 +661,9 @@ ISR(TIMER3_COMPA_vect)
 #ifdef USE_TIMER4
 ISR(TIMER4_COMPA_vect)
 {
-  if (timer4_toggle_count != 0)
-  {
-    // toggle the pin
-    *timer4_pin_port ^= timer4_pin_mask;
-
-    if (timer4_toggle_count > 0)
-      timer4_toggle_count--;
-  }
-  else
-  {
-    disableTimer(4);
-    *timer4_pin_port &= ~(timer4_pin_mask);  // keep pin low after stop
-  }
+  PROFILE_ISR_BEGIN();
+  toneInterrupt(TIMER4_CHANNEL);
+  PROFILE_ISR_END(PROFILE_TONE);
 }
 #endif
 
@@ -600,18 +671,8 @@ ISR(TIMER4_COMPA_vect)
 #ifdef USE_TIMER5
 ISR(TIMER5_COMPA_vect)
 {
-  if (timer5_toggle_count != 0)
-  {
-    // toggle the pin
-    *timer5_pin_port ^= timer5_pin_mask;
-
-    if (timer5_toggle_count > 0)
-      timer5_toggle_count--;
-  }
-  else
-  {
-    disableTimer(5);
-    *timer5_pin_port &= ~(timer5_pin_mask);  // keep pin low after stop
-  }
+  PROFILE_ISR_BEGIN();
+  toneInterrupt(TIMER5_CHANNEL);
+  PROFILE_ISR_END(PROFILE_TONE);
 }
 #endif
@@ -33,6 +33,10 @@
 #include "wiring_private.h"
 
 static volatile voidFuncPtr intFunc[EXTERNAL_NUM_INTERRUPTS];
+
+// The vectors below are weak, so a handler defined with
+// INTERRUPT_HANDLER() in the sketch takes their place.
+#define INT_HANDLER(vector) ISR(vector, __attribute__((weak)))
 // volatile static voidFuncPtr twiIntFunc;
 
 void attachInterrupt(uint8_t interruptNum, void (*userFunc)(void), int mode) {
@@ -230,82 +234,82 @@ void attachInterruptTwi(void (*userFunc)(void) ) {
 */
 
 #if defined(__AVR_ATmega32U4__)
-SIGNAL(INT0_vect) {
+INT_HANDLER(INT0_vect) {
 	if(intFunc[EXTERNAL_INT_0])
 		intFunc[EXTERNAL_INT_0]();
 }
 
-SIGNAL(INT1_vect) {
+INT_HANDLER(INT1_vect) {
 	if(intFunc[EXTERNAL_INT_1])
 		intFunc[EXTERNAL_INT_1]();
 }
 
-SIGNAL(INT2_vect) {
+INT_HANDLER(INT2_vect) {
     if(intFunc[EXTERNAL_INT_2])
 		intFunc[EXTERNAL_INT_2]();
 }
 
-SIGNAL(INT3_vect) {
+INT_HANDLER(INT3_vect) {
     if(intFunc[EXTERNAL_INT_3])
 		intFunc[EXTERNAL_INT_3]();
 }
 
 #elif defined(EICRA) && defined(EICRB)
 
-SIGNAL(INT0_vect) {
+INT_HANDLER(INT0_vect) {
   if(intFunc[EXTERNAL_INT_2])
     intFunc[EXTERNAL_INT_2]();
 }
 
-SIGNAL(INT1_vect) {
+INT_HANDLER(INT1_vect) {
   if(intFunc[EXTERNAL_INT_3])
     intFunc[EXTERNAL_INT_3]();
 }
 
-SIGNAL(INT2_vect) {
+INT_HANDLER(INT2_vect) {
   if(intFunc[EXTERNAL_INT_4])
     intFunc[EXTERNAL_INT_4]();
 }
 
-SIGNAL(INT3_vect) {
+INT_HANDLER(INT3_vect) {
   if(intFunc[EXTERNAL_INT_5])
     intFunc[EXTERNAL_INT_5]();
 }
 
-SIGNAL(INT4_vect) {
+INT_HANDLER(INT4_vect) {
   if(intFunc[EXTERNAL_INT_0])
     intFunc[EXTERNAL_INT_0]();
 }
 
-SIGNAL(INT5_vect) {
+INT_HANDLER(INT5_vect) {
   if(intFunc[EXTERNAL_INT_1])
     intFunc[EXTERNAL_INT_1]();
 }
 
-SIGNAL(INT6_vect) {
+INT_HANDLER(INT6_vect) {
   if(intFunc[EXTERNAL_INT_6])
     intFunc[EXTERNAL_INT_6]();
 }
 
-SIGNAL(INT7_vect) {
+INT_HANDLER(INT7_vect) {
   if(intFunc[EXTERNAL_INT_7])
     intFunc[EXTERNAL_INT_7]();
 }
 
 #else
 
-SIGNAL(INT0_vect) {
+INT_HANDLER(INT0_vect) {
   if(intFunc[EXTERNAL_INT_0])
     intFunc[EXTERNAL_INT_0]();
 }
 
-SIGNAL(INT1_vect) {
+INT_HANDLER(INT1_vect) {
   if(intFunc[EXTERNAL_INT_1])
     intFunc[EXTERNAL_INT_1]();
 }
 
 #if defined(EICRA) && defined(ISC20)
-SIGNAL(INT2_vect) {
+INT_HANDLER(INT2_vect) {
   if(intFunc[EXTERNAL_INT_2])
     intFunc[EXTERNAL_INT_2]();
 }
@@ -0,0 +1,146 @@
+/*
+  WPinChangeInterrupts.c - pin change interrupts with per pin callbacks
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#include <inttypes.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+#include "wiring_private.h"
+#include "pins_arduino.h"
+
+#if defined(PCICR) && defined(digitalPinToPCICR)
+
+// Pin change interrupts fire on any change of any enabled pin of a group
+// of eight. The handler of a group compares the port with a snapshot of
+// its last state to find out which pins changed in which direction, then
+// calls the callbacks of those pins which asked for that edge.
+//
+// This assumes the pins of a group are the pins of one port, with the
+// PCMSK bit being the port bit, which is true for the ATmega644/1284
+// family and the ATmega328.
+
+#if defined(PCINT3_vect)
+#define PCINT_GROUPS 4
+#elif defined(PCINT2_vect)
+#define PCINT_GROUPS 3
+#else
+#define PCINT_GROUPS 2
+#endif
+
+typedef struct {
+	volatile uint8_t *in;	// PINx of the group's port
+	uint8_t last;		// port state as of the last interrupt
+	uint8_t rising;		// pins wanting rising edges
+	uint8_t falling;	// pins wanting falling edges
+	voidFuncPtr func[8];
+} PinChangeGroup;
+
+static PinChangeGroup pcint_groups[PCINT_GROUPS];
+
+void attachPinChangeInterrupt(uint8_t pin, void (*userFunc)(void), int mode)
+{
+	volatile uint8_t *pcicr = digitalPinToPCICR(pin);
+	uint8_t group, bit, mask;
+	PinChangeGroup *g;
+
+	if (pcicr == 0 || pin >= NUM_DIGITAL_PINS) return;
+	group = digitalPinToPCICRbit(pin);
+	bit = digitalPinToPCMSKbit(pin);
+	if (group >= PCINT_GROUPS) return;
+	mask = 1 << bit;
+	g = &pcint_groups[group];
+
+	uint8_t oldSREG = SREG;
+	cli();
+	g->in = portInputRegister(digitalPinToPort(pin));
+	g->func[bit] = userFunc;
+	if (mode == RISING || mode == CHANGE) g->rising |= mask;
+	else g->rising &= ~mask;
+	if (mode == FALLING || mode == CHANGE) g->falling |= mask;
+	else g->falling &= ~mask;
+	// start from the current level, so attaching doesn't fire
+	g->last = (g->last & ~mask) | (*g->in & mask);
+	*digitalPinToPCMSK(pin) |= mask;
+	*pcicr |= 1 << group;
+	SREG = oldSREG;
+}
+
+void detachPinChangeInterrupt(uint8_t pin)
+{
+	volatile uint8_t *pcicr = digitalPinToPCICR(pin);
+	volatile uint8_t *pcmsk;
+	uint8_t group, bit;
+
+	if (pcicr == 0 || pin >= NUM_DIGITAL_PINS) return;
+	group = digitalPinToPCICRbit(pin);
+	bit = digitalPinToPCMSKbit(pin);
+	if (group >= PCINT_GROUPS) return;
+	pcmsk = digitalPinToPCMSK(pin);
+
+	uint8_t oldSREG = SREG;
+	cli();
+	*pcmsk &= ~(1 << bit);
+	if (*pcmsk == 0) *pcicr &= ~(1 << group);
+	pcint_groups[group].rising &= ~(1 << bit);
+	pcint_groups[group].falling &= ~(1 << bit);
+	pcint_groups[group].func[bit] = 0;
+	SREG = oldSREG;
+}
+
+// group is a constant in each vector below, so this is inlined with the
+// group's table address folded in
+static inline void pinChangeDispatch(uint8_t group) __attribute__((always_inline));
+static inline void pinChangeDispatch(uint8_t group)
+{
+	PinChangeGroup *g = &pcint_groups[group];
+	uint8_t now = *g->in;
+	uint8_t changed = now ^ g->last;
+	uint8_t fire, bit;
+
+	g->last = now;
+	fire = (changed & now & g->rising) | (changed & ~now & g->falling);
+
+	for (bit = 0; fire; bit++, fire >>= 1) {
+		if ((fire & 1) && g->func[bit]) g->func[bit]();
+	}
+}
+
+ISR(PCINT0_vect) {
+	pinChangeDispatch(0);
+}
+
+ISR(PCINT1_vect) {
+	pinChangeDispatch(1);
+}
+
+#if PCINT_GROUPS > 2
+ISR(PCINT2_vect) {
+	pinChangeDispatch(2);
+}
+#endif
+
+#if PCINT_GROUPS > 3
+ISR(PCINT3_vect) {
+	pinChangeDispatch(3);
+}
+#endif
+
+#endif
@@ -21,6 +21,11 @@
 
 #include "WString.h"
 
+#if defined(__AVR__)
+extern char *__malloc_heap_start;
+#endif
+
+static unsigned int string_heap_high_water = 0;
 
 /*********************************************/
 /*  Constructors                             */
@@ -134,17 +139,49 @@ unsigned char String::reserve(unsigned int size)
 	return 0;
 }
 
+// like reserve(), but grows geometrically, see STRING_GROWTH_MIN/_MAX
+unsigned char String::grow(unsigned int size)
+{
+	if (buffer && capacity >= size) return 1;
+	unsigned int step = capacity;
+	if (step < STRING_GROWTH_MIN) step = STRING_GROWTH_MIN;
+	if (step > STRING_GROWTH_MAX) step = STRING_GROWTH_MAX;
+	unsigned int newcap = capacity + step;
+	if (newcap > size) {
+		if (changeBuffer(newcap)) {
+			if (len == 0) buffer[0] = 0;
+			return 1;
+		}
+		// not enough memory for the spare room, try the exact size
+	}
+	return reserve(size);
+}
+
+void String::shrinkToFit(void)
+{
+	if (buffer && capacity > len) changeBuffer(len);
+}
+
 unsigned char String::changeBuffer(unsigned int maxStrLen)
 {
 	char *newbuffer = (char *)realloc(buffer, maxStrLen + 1);
 	if (newbuffer) {
 		buffer = newbuffer;
 		capacity = maxStrLen;
+#if defined(__AVR__)
+		unsigned int top = newbuffer + maxStrLen + 1 - __malloc_heap_start;
+		if (top > string_heap_high_water) string_heap_high_water = top;
+#endif
 		return 1;
 	}
 	return 0;
 }
 
+unsigned int String::stringHeapHighWaterMark(void)
+{
+	return string_heap_high_water;
+}
+
 /*********************************************/
 /*  Copy and Move                            */
 /*********************************************/
@@ -228,7 +265,7 @@ unsigned char String::concat(const char *cstr, unsigned int length)
 	unsigned int newlen = len + length;
 	if (!cstr) return 0;
 	if (length == 0) return 1;
-	if (!reserve(newlen)) return 0;
+	if (!grow(newlen)) return 0;
 	strcpy(buffer + len, cstr);
 	len = newlen;
 	return 1;
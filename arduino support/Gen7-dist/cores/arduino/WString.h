@@ -34,6 +34,14 @@
 //     -felide-constructors
 //     -std=c++0x
 
+// Growth policy for concatenation: the buffer capacity doubles, starting
+// at STRING_GROWTH_MIN characters and never growing by more than
+// STRING_GROWTH_MAX characters at once. This keeps building a string one
+// character at a time (e.g. Stream::readString()) from reallocating and
+// copying the whole string for every character appended.
+#define STRING_GROWTH_MIN 8
+#define STRING_GROWTH_MAX 64
+
 class __FlashStringHelper;
 #define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(PSTR(string_literal)))
 
@@ -76,6 +84,13 @@ public:
 	// invalid string (i.e., "if (s)" will be true afterwards)
 	unsigned char reserve(unsigned int size);
 	inline unsigned int length(void) const {return len;}
+	// release spare capacity left over from concatenations
+	void shrinkToFit(void);
+	// the largest number of heap bytes (counted from the start of the heap)
+	// ever spanned by a String buffer. Only String buffers are tracked,
+	// blocks of other malloc() or new users don't count. Useful to find
+	// out how close String usage came to the stack.
+	static unsigned int stringHeapHighWaterMark(void);
 
 	// creates a copy of the assigned value.  if the value is null or
 	// invalid, or if the memory allocation fails, the string will be 
@@ -179,6 +194,7 @@ protected:
 	void init(void);
 	void invalidate(void);
 	unsigned char changeBuffer(unsigned int maxStrLen);
+	unsigned char grow(unsigned int size);
 	unsigned char concat(const char *cstr, unsigned int length);
 
 	// copy and move
@@ -0,0 +1,156 @@
+/*
+  Watchdog.c - watchdog supervision of the main loop and its tasks
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#include "wiring_private.h"
+#include "Watchdog.h"
+
+#if defined(WDT_vect) && defined(WDIE)
+
+static uint8_t watchdog_pins[WATCHDOG_MAX_PINS];
+static uint8_t watchdog_pin_count;
+
+static unsigned long watchdog_period[WATCHDOG_MAX_DEADLINES];	// 0 is unused
+static unsigned long watchdog_last[WATCHDOG_MAX_DEADLINES];	// last check in
+
+static uint8_t watchdog_reset_cause __attribute__((section(".noinit")));
+
+// set in r3 by the Gen7 bootloader along with the reset cause, see
+// stk500boot.c
+#define RESET_CAUSE_MARKER 0xB7
+
+// After a watchdog reset the watchdog stays enabled with its shortest
+// timeout. Gen7 boards start in the bootloader, which turns it off, clears
+// MCUSR and hands its value over in r2, with a marker in r3 and the
+// complement in r4. Without that bootloader, r2 holds whatever it held, and
+// turning the watchdog off is up to us, before the variables are even
+// initialised. Runs from .init3, the stack is set up by then and r2 to r4
+// are untouched.
+void watchdogInit(void) __attribute__((naked, used, section(".init3")));
+void watchdogInit(void)
+{
+	uint8_t cause = MCUSR, handed, marker, complement;
+
+	__asm__ __volatile__ ("mov %0, r2" "\n\t"
+	                      "mov %1, r3" "\n\t"
+	                      "mov %2, r4"
+	                      : "=&r" (handed), "=&r" (marker), "=&r" (complement));
+	if (cause == 0 && marker == RESET_CAUSE_MARKER &&
+	    complement == (uint8_t)~handed)
+		cause = handed;
+	watchdog_reset_cause = cause;
+	MCUSR = 0;
+	wdt_disable();
+}
+
+uint8_t watchdogCausedReset(void)
+{
+	return (watchdog_reset_cause & (1 << WDRF)) != 0;
+}
+
+uint8_t watchdogBegin(const uint8_t *safePins, uint8_t count, uint8_t timeout)
+{
+	unsigned long now = millis();
+	uint8_t i;
+
+	if (count > WATCHDOG_MAX_PINS) return 0;
+
+	uint8_t oldSREG = SREG;
+	cli();
+	// copied, so the interrupt doesn't depend on the sketch's memory
+	for (i = 0; i < count; i++) watchdog_pins[i] = safePins[i];
+	watchdog_pin_count = count;
+	for (i = 0; i < WATCHDOG_MAX_DEADLINES; i++) watchdog_last[i] = now;
+
+	// interrupt first, reset on the next timeout
+	wdt_enable(timeout);
+	WDTCSR |= (1 << WDIE);
+	SREG = oldSREG;
+	return 1;
+}
+
+void watchdogEnd(void)
+{
+	uint8_t oldSREG = SREG;
+	cli();
+	wdt_disable();
+	SREG = oldSREG;
+}
+
+int8_t watchdogDeadline(unsigned long period)
+{
+	uint8_t i;
+
+	if (period == 0) return -1;
+	for (i = 0; i < WATCHDOG_MAX_DEADLINES; i++) {
+		if (watchdog_period[i] == 0) {
+			watchdog_last[i] = millis();
+			watchdog_period[i] = period;
+			return i;
+		}
+	}
+	return -1;
+}
+
+void watchdogCheckIn(int8_t id)
+{
+	if (id >= 0 && id < WATCHDOG_MAX_DEADLINES) watchdog_last[id] = millis();
+}
+
+void watchdogRelease(int8_t id)
+{
+	if (id >= 0 && id < WATCHDOG_MAX_DEADLINES) watchdog_period[id] = 0;
+}
+
+void watchdogService(void)
+{
+	unsigned long now = millis();
+	uint8_t i;
+
+	for (i = 0; i < WATCHDOG_MAX_DEADLINES; i++) {
+		if (watchdog_period[i] && now - watchdog_last[i] > watchdog_period[i])
+			return;
+	}
+	wdt_reset();
+}
+
+// The last step before the reset: the hardware clears WDIE when calling
+// us, so the next timeout resets, and as we never return, nothing can
+// reset the watchdog meanwhile.
+ISR(WDT_vect)
+{
+	uint8_t i;
+
+	// software PWM (wiring_softpwm.c) would set its pins again at the
+	// start of its next period, so stop it first
+#if defined(OCIE0B)
+	TIMSK0 &= ~(1 << OCIE0B);
+#endif
+	for (i = 0; i < watchdog_pin_count; i++) {
+		digitalWrite(watchdog_pins[i], LOW);
+		pinMode(watchdog_pins[i], OUTPUT);
+	}
+
+	// no need to wait for a long timeout once the pins are safe
+	wdt_enable(WDTO_15MS);
+	for (;;)
+		;
+}
+
+#endif
@@ -0,0 +1,73 @@
+/*
+  Watchdog.h - watchdog supervision of the main loop and its tasks
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#ifndef Watchdog_h
+#define Watchdog_h
+
+#include <inttypes.h>
+#include <avr/wdt.h>
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+// Once started, the hardware watchdog is reset from the main loop and
+// from delay() only while every registered deadline is met, i.e. each
+// user of a deadline checked in within its period:
+//
+//   const uint8_t heaters[] = { 12, 13 };
+//   int8_t temp;
+//
+//   void setup() {
+//     watchdogBegin(heaters, 2, WDTO_500MS);
+//     temp = watchdogDeadline(200);
+//   }
+//   void loop() {
+//     ... read and control temperatures ...
+//     watchdogCheckIn(temp);
+//   }
+//
+// If the watchdog isn't reset in time, its interrupt stops software PWM
+// and switches the safe pins to output LOW, turning off hardware PWM on
+// them, then waits for the reset, which follows within 15 ms. There's
+// no recovering from a missed deadline. A reset makes all pins inputs
+// anyway. The Gen7 bootloader turns the watchdog off after
+// such a reset, so it doesn't fire again while waiting for the programmer.
+
+#define WATCHDOG_MAX_PINS 8
+#define WATCHDOG_MAX_DEADLINES 8
+
+// timeout is one of the WDTO_* constants of <avr/wdt.h>
+uint8_t watchdogBegin(const uint8_t *safePins, uint8_t count, uint8_t timeout);
+void watchdogEnd(void);
+// returns the id to check in with, or -1 if all are taken
+int8_t watchdogDeadline(unsigned long period);	// ms
+void watchdogCheckIn(int8_t id);
+void watchdogRelease(int8_t id);
+// resets the watchdog if all deadlines are met; called by the core
+void watchdogService(void) __attribute__((weak));
+// whether the last reset was caused by the watchdog
+uint8_t watchdogCausedReset(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif
@@ -1,4 +1,8 @@
 #include <Arduino.h>
+#include "Scheduler.h"
+#include "Profiler.h"
+#include "Watchdog.h"
+#include "MemoryMonitor.h"
 
 int main(void)
 {
@@ -11,8 +15,14 @@ int main(void)
 	setup();
     
 	for (;;) {
+		PROFILE_LONG_BEGIN();
 		loop();
+		PROFILE_LONG_END(PROFILE_LOOP);
+		profilerService();
 		if (serialEventRun) serialEventRun();
+		if (schedulerRun) schedulerRun();
+		if (watchdogService) watchdogService();
+		if (memoryGuardService) memoryGuardService();
 	}
         
 	return 0;
@@ -23,23 +23,35 @@
 */
 
 #include "wiring_private.h"
+#include <avr/sleep.h>
+#include "Scheduler.h"
+#include "Watchdog.h"
+#include "MemoryMonitor.h"
 
 // the prescaler is set so that timer0 ticks every 64 clock cycles, and the
 // the overflow handler is called every 256 ticks.
 #define MICROSECONDS_PER_TIMER0_OVERFLOW (clockCyclesToMicroseconds(64 * 256))
 
+// the clock cycles per overflow not adding up to a whole microsecond,
+// e.g. 4 at 20 MHz, where an overflow takes 819.2 microseconds. the
+// overflow handler collects them, so micros() stays exact.
+#define CYCLES_FRACT_INC ((64 * 256) % clockCyclesPerMicrosecond())
+
 // the whole number of milliseconds per timer0 overflow
 #define MILLIS_INC (MICROSECONDS_PER_TIMER0_OVERFLOW / 1000)
 
-// the fractional number of milliseconds per timer0 overflow. we shift right
-// by three to fit these numbers into a byte. (for the clock speeds we care
-// about - 8 and 16 MHz - this doesn't lose precision.)
-#define FRACT_INC ((MICROSECONDS_PER_TIMER0_OVERFLOW % 1000) >> 3)
-#define FRACT_MAX (1000 >> 3)
+// the fractional number of milliseconds per timer0 overflow, in
+// microseconds.
+#define FRACT_INC (MICROSECONDS_PER_TIMER0_OVERFLOW % 1000)
+#define FRACT_MAX 1000
 
 volatile unsigned long timer0_overflow_count = 0;
 volatile unsigned long timer0_millis = 0;
-static unsigned char timer0_fract = 0;
+// extends timer0_overflow_count to 48 bits for cycles64()
+volatile unsigned int timer0_overflow_count_high = 0;
+static volatile unsigned long timer0_micros = 0;
+static volatile unsigned char timer0_cycles = 0;
+static unsigned int timer0_fract = 0;
 
 #if defined (TIM0_OVF_vect)
 SIGNAL(TIM0_OVF_vect)
@@ -47,13 +59,25 @@ SIGNAL(TIM0_OVF_vect)
 SIGNAL(TIMER0_OVF_vect)
 #endif
 {
+	PROFILE_ISR_BEGIN();
+
 	// copy these to local variables so they can be stored in registers
 	// (volatile variables must be read from memory on every access)
 	unsigned long m = timer0_millis;
-	unsigned char f = timer0_fract;
+	unsigned int f = timer0_fract;
+	unsigned char inc = 0;
+
+#if CYCLES_FRACT_INC
+	unsigned char c = timer0_cycles + CYCLES_FRACT_INC;
+	if (c >= clockCyclesPerMicrosecond()) {
+		c -= clockCyclesPerMicrosecond();
+		inc = 1;
+	}
+	timer0_cycles = c;
+#endif
 
 	m += MILLIS_INC;
-	f += FRACT_INC;
+	f += FRACT_INC + inc;
 	if (f >= FRACT_MAX) {
 		f -= FRACT_MAX;
 		m += 1;
@@ -61,7 +85,11 @@ SIGNAL(TIMER0_OVF_vect)
 
 	timer0_fract = f;
 	timer0_millis = m;
-	timer0_overflow_count++;
+	timer0_micros += MICROSECONDS_PER_TIMER0_OVERFLOW + inc;
+	if (++timer0_overflow_count == 0)
+		timer0_overflow_count_high++;
+
+	PROFILE_ISR_END(PROFILE_TIMER0_OVF);
 }
 
 unsigned long millis()
@@ -78,46 +106,139 @@ unsigned long millis()
 	return m;
 }
 
-unsigned long micros() {
-	unsigned long m;
-	uint8_t oldSREG = SREG, t;
-	
-	cli();
-	m = timer0_overflow_count;
+// reads TCNT0 and tells whether an overflow is pending, which the
+// caller has to account for; call with interrupts disabled
+static inline uint8_t timer0_read(uint8_t *t)
+{
 #if defined(TCNT0)
-	t = TCNT0;
+	*t = TCNT0;
 #elif defined(TCNT0L)
-	t = TCNT0L;
+	*t = TCNT0L;
 #else
 	#error TIMER 0 not defined
 #endif
 
-  
 #ifdef TIFR0
-	if ((TIFR0 & _BV(TOV0)) && (t < 255))
-		m++;
+	return (TIFR0 & _BV(TOV0)) && (*t < 255);
 #else
-	if ((TIFR & _BV(TOV0)) && (t < 255))
-		m++;
+	return (TIFR & _BV(TOV0)) && (*t < 255);
 #endif
+}
+
+unsigned long micros() {
+	unsigned long m;
+	unsigned int c;
+	uint8_t oldSREG = SREG, t;
 
+	cli();
+	m = timer0_micros;
+	c = timer0_cycles;
+	if (timer0_read(&t)) {
+		m += MICROSECONDS_PER_TIMER0_OVERFLOW;
+		c += CYCLES_FRACT_INC;
+	}
 	SREG = oldSREG;
-	
-	return ((m << 8) + t) * (64 / clockCyclesPerMicrosecond());
+
+	// a constant division; shifts for 8 and 16 MHz
+	return m + (((unsigned int)t << 6) + c) / clockCyclesPerMicrosecond();
+}
+
+uint64_t cycles64(void)
+{
+	uint64_t n;
+	uint8_t oldSREG = SREG, t;
+
+	cli();
+	n = ((uint64_t)timer0_overflow_count_high << 32) | timer0_overflow_count;
+	if (timer0_read(&t))
+		n++;
+	SREG = oldSREG;
+
+	return ((n << 8) + t) << 6;
+}
+
+uint64_t micros64(void)
+{
+	uint64_t c = cycles64();
+
+#if (clockCyclesPerMicrosecond() & (clockCyclesPerMicrosecond() - 1)) == 0
+	// a shift for 1, 2, 4, 8 and 16 MHz
+	return c >> __builtin_ctz(clockCyclesPerMicrosecond());
+#else
+	// Long division in 24 bit steps, each a 32 bit division by the
+	// constant; the remainder is less than it, so fits into the top 8
+	// bits of the next step. A 64 bit division would pull in __udivdi3,
+	// about 1 KB of flash and thousands of cycles.
+	const uint32_t d = clockCyclesPerMicrosecond();
+	uint32_t hi = c >> 48;
+	uint32_t mid = ((uint32_t)(c >> 24) & 0xFFFFFF) | ((hi % d) << 24);
+	uint32_t lo = ((uint32_t)c & 0xFFFFFF) | ((mid % d) << 24);
+
+	return ((uint64_t)(hi / d) << 48) | ((uint64_t)(mid / d) << 24) | (lo / d);
+#endif
+}
+
+static void __empty() {
+	// Empty
+}
+// called while delay() and idleUntil() wait; override it to run
+// background work meanwhile
+void yield(void) __attribute__ ((weak, alias("__empty")));
+
+// what delay() and idleUntil() do while they wait: the scheduler's tasks,
+// the watchdog and the stack guard, if a sketch uses them, then yield()
+static void background(void)
+{
+	if (schedulerRun) schedulerRun();
+	if (watchdogService) watchdogService();
+	if (memoryGuardService) memoryGuardService();
+	yield();
+}
+
+// Sleeps until the next interrupt, Timer0 wakes us at least once per
+// overflow. Idle mode keeps timers, UARTs and the ADC running. Doesn't
+// sleep with interrupts disabled, nothing would wake us.
+static void idle(void)
+{
+	if (SREG & _BV(SREG_I)) {
+		set_sleep_mode(SLEEP_MODE_IDLE);
+		sleep_mode();
+	}
 }
 
 void delay(unsigned long ms)
 {
-	uint16_t start = (uint16_t)micros();
+	unsigned long start = micros();
+	unsigned long elapsed;
 
 	while (ms > 0) {
-		if (((uint16_t)micros() - start) >= 1000) {
+		background();
+		// background work may have taken many milliseconds, retire all
+		// of them before running it again
+		elapsed = micros() - start;
+		while (elapsed >= 1000 && ms > 0) {
 			ms--;
 			start += 1000;
+			elapsed -= 1000;
+		}
+		if (ms > MILLIS_INC + 1 ||
+		    (ms > 0 && ms * 1000 - elapsed > MICROSECONDS_PER_TIMER0_OVERFLOW)) {
+			// more than one overflow to go, so sleeping can't overshoot
+			idle();
 		}
 	}
 }
 
+void idleUntil(unsigned long deadline)
+{
+	// millis() changes in the overflow handler only, so sleeping until
+	// the next interrupt never overshoots
+	while ((long)(millis() - deadline) < 0) {
+		background();
+		idle();
+	}
+}
+
 /* Delay for the given number of microseconds.  Assumes a 8 or 16 MHz clock. */
 void delayMicroseconds(unsigned int us)
 {
@@ -180,10 +301,16 @@ void delayMicroseconds(unsigned int us)
 #endif
 
 	// busy wait
+#if defined(__AVR__)
 	__asm__ __volatile__ (
 		"1: sbiw %0,1" "\n\t" // 2 cycles
 		"brne 1b" : "=w" (us) : "0" (us) // 2 cycles
 	);
+#else
+	// host builds (tools/host-core) have no cycle exact timing anyways
+	while (us--)
+		__asm__ __volatile__ ("");
+#endif
 }
 
 void init()
@@ -255,6 +382,15 @@ void init()
 	#warning this needs to be finished
 #endif
 
+#if defined(PROFILER) && defined(TCCR1A) && defined(ICR1) && defined(WGM13)
+	// the profiler's time base counts every cycle over the full 16 bits;
+	// fast PWM with TOP = ICR1 keeps analogWrite() going, it scales to
+	// pwm_timer1_top (see Profiler.h)
+	ICR1 = 0xFFFF;
+	TCCR1A = (1 << WGM11);
+	TCCR1B = (1 << WGM13) | (1 << WGM12) | (1 << CS10);
+#endif
+
 	// set timer 2 prescale factor to 64
 #if defined(TCCR2) && defined(CS22)
 	sbi(TCCR2, CS22);
@@ -301,13 +437,9 @@ void init()
 #endif
 
 #if defined(ADCSRA)
-	// set a2d prescale factor to 128
-	// 16 MHz / 128 = 125 KHz, inside the desired 50-200 KHz range.
-	// XXX: this will not work properly for other clock speeds, and
-	// this code should use F_CPU to determine the prescale factor.
-	sbi(ADCSRA, ADPS2);
-	sbi(ADCSRA, ADPS1);
-	sbi(ADCSRA, ADPS0);
+	// set a2d prescale factor for the fastest clock inside the
+	// 50-200 KHz range, e.g. 128 at 16 and 20 MHz (125 and 156 KHz)
+	ADCSRA = (ADCSRA & ~ADC_PRESCALER_MASK) | ADC_PRESCALER;
 
 	// enable a2d conversions
 	sbi(ADCSRA, ADEN);
@@ -0,0 +1,171 @@
+/*
+  wiring_adc.c - interrupt driven background sampling of analog inputs
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#include "wiring_private.h"
+#include "pins_arduino.h"
+
+#if defined(ADCSRA) && defined(ADATE) && defined(ADC_vect)
+
+// The converter runs in free running mode, so a new conversion starts
+// as soon as the previous one finishes. The multiplexer is sampled at
+// the start of a conversion; when the interrupt for one result fires,
+// the next conversion is already running. Changing ADMUX there selects
+// the channel for the conversion after that, so the interrupt keeps
+// track of two slots: the one just finished and the one running.
+
+static uint8_t adc_count;
+static uint8_t adc_shift;
+static uint8_t adc_pin[ANALOG_SAMPLE_MAX_CHANNELS];	// channel numbers
+static uint8_t adc_mux[ANALOG_SAMPLE_MAX_CHANNELS];
+#if defined(MUX5)
+static uint8_t adc_mux5[ANALOG_SAMPLE_MAX_CHANNELS];
+#endif
+
+static uint8_t adc_done;	// slot of the result being read
+static uint8_t adc_running;	// slot of the conversion in progress
+
+static uint16_t adc_acc[ANALOG_SAMPLE_MAX_CHANNELS];
+static uint8_t adc_n[ANALOG_SAMPLE_MAX_CHANNELS];
+
+// the finished sums; adc_seq changes whenever one of them does
+static volatile uint16_t adc_sum[ANALOG_SAMPLE_MAX_CHANNELS];
+static volatile uint8_t adc_valid;
+static volatile uint8_t adc_seq;
+
+static void adcSelect(uint8_t slot)
+{
+#if defined(MUX5)
+	ADCSRB = (ADCSRB & ~(1 << MUX5)) | adc_mux5[slot];
+#endif
+	ADMUX = (analog_reference << 6) | adc_mux[slot];
+}
+
+uint8_t analogSampleBegin(const uint8_t *pins, uint8_t count, uint8_t oversampleShift)
+{
+	uint8_t i, ch;
+
+	if (count == 0 || count > ANALOG_SAMPLE_MAX_CHANNELS || oversampleShift > 6)
+		return 0;
+
+	analogSampleEnd();
+
+	for (i = 0; i < count; i++) {
+		ch = pins[i];
+		if (ch >= ANALOG_PIN_OFFSET) ch -= ANALOG_PIN_OFFSET;
+		adc_pin[i] = ch;
+#if defined(__AVR_ATmega32U4__)
+		ch = analogPinToChannel(ch);
+#endif
+		adc_mux[i] = ch & 0x07;
+#if defined(MUX5)
+		adc_mux5[i] = ((ch >> 3) & 0x01) << MUX5;
+#endif
+		adc_acc[i] = 0;
+		adc_n[i] = 0;
+	}
+	adc_count = count;
+	adc_shift = oversampleShift;
+	adc_valid = 0;
+
+	// the first two conversions both use slot 0, see above
+	adc_done = 0;
+	adc_running = 0;
+	adcSelect(0);
+
+#if defined(ADCSRB)
+	ADCSRB &= ~((1 << ADTS2) | (1 << ADTS1) | (1 << ADTS0));	// free running
+#endif
+	ADCSRA |= (1 << ADATE) | (1 << ADIE) | (1 << ADIF);
+	sbi(ADCSRA, ADSC);
+	return 1;
+}
+
+void analogSampleEnd(void)
+{
+	ADCSRA &= ~((1 << ADATE) | (1 << ADIE));
+
+	// let a running conversion finish, so analogRead() starts clean
+	while (bit_is_set(ADCSRA, ADSC));
+	sbi(ADCSRA, ADIF);
+	adc_count = 0;
+}
+
+static int8_t adcSlot(uint8_t pin)
+{
+	uint8_t i;
+
+	// allow for channel or pin numbers, as analogRead() does
+	if (pin >= ANALOG_PIN_OFFSET) pin -= ANALOG_PIN_OFFSET;
+	for (i = 0; i < adc_count; i++) {
+		if (adc_pin[i] == pin) return i;
+	}
+	return -1;
+}
+
+long analogLatestSum(uint8_t pin)
+{
+	int8_t slot = adcSlot(pin);
+	uint16_t sum;
+	uint8_t seq, valid;
+
+	if (slot < 0) return -1;
+
+	// no locking: if the interrupt stored a result meanwhile, read again
+	do {
+		seq = adc_seq;
+		sum = adc_sum[slot];
+		valid = adc_valid;
+	} while (seq != adc_seq);
+
+	if (!(valid & (1 << slot))) return -1;
+	return sum;
+}
+
+int analogLatest(uint8_t pin)
+{
+	long sum = analogLatestSum(pin);
+
+	if (sum < 0) return -1;
+	return sum >> adc_shift;
+}
+
+ISR(ADC_vect)
+{
+	PROFILE_ISR_BEGIN();
+	uint8_t slot = adc_done;
+	uint16_t value = ADC;
+
+	adc_acc[slot] += value;
+	if (++adc_n[slot] >> adc_shift) {
+		adc_sum[slot] = adc_acc[slot];
+		adc_valid |= 1 << slot;
+		adc_seq++;
+		adc_acc[slot] = 0;
+		adc_n[slot] = 0;
+	}
+
+	adc_done = adc_running;
+	if (++adc_running >= adc_count) adc_running = 0;
+	adcSelect(adc_running);
+
+	PROFILE_ISR_END(PROFILE_ADC);
+}
+
+#endif
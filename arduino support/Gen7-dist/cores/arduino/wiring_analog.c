@@ -29,6 +29,9 @@
 
 uint8_t analog_reference = DEFAULT;
 
+// defined in wiring_adc.c, linked in only if a sketch uses the engine
+int analogLatest(uint8_t pin) __attribute__((weak));
+
 void analogReference(uint8_t mode)
 {
 	// can't actually set the register here because the default setting
@@ -41,16 +44,11 @@ int analogRead(uint8_t pin)
 {
 	uint8_t low, high;
 
-#if defined(PORTL) // 100 pin chips
-	if (pin >= 54) pin -= 54; // allow for channel or pin numbers
-#elif defined(__AVR_ATmega32U4__)
-	if (pin >= 18) pin -= 18; // allow for channel or pin numbers
-#elif defined(PORTA) // 40/44 pin chips
-	if (pin >= 24) pin -= 24; // allow for channel or pin numbers
-#else
-	if (pin >= 14) pin -= 14; // allow for channel or pin numbers
-#endif
-	
+	// while the sampling engine owns the ADC, hand out its results
+	if (analogLatest && bit_is_set(ADCSRA, ADIE)) return analogLatest(pin);
+
+	if (pin >= ANALOG_PIN_OFFSET) pin -= ANALOG_PIN_OFFSET; // allow for channel or pin numbers
+
 #if defined(__AVR_ATmega32U4__)
 	pin = analogPinToChannel(pin);
 	ADCSRB = (ADCSRB & ~(1 << MUX5)) | (((pin >> 3) & 0x01) << MUX5);
@@ -93,12 +91,84 @@ int analogRead(uint8_t pin)
 	return (high << 8) | low;
 }
 
+// 8 bit conversion with a faster ADC clock (see ADC_MAX_CLOCK_FAST),
+// for inputs where the lower two bits don't matter. Takes 13 us at
+// 16 MHz and 21 us at 20 MHz, instead of 104 us.
+int analogReadFast(uint8_t pin)
+{
+	uint8_t result;
+
+	// the sampling engine owns the ADC, so there is no fallback to a
+	// conversion of our own; pass its -1 on instead of shifting it
+	if (analogLatest && bit_is_set(ADCSRA, ADIE)) {
+		int latest = analogLatest(pin);
+		return latest < 0 ? -1 : latest >> 2;
+	}
+
+	if (pin >= ANALOG_PIN_OFFSET) pin -= ANALOG_PIN_OFFSET; // allow for channel or pin numbers
+
+#if defined(__AVR_ATmega32U4__)
+	pin = analogPinToChannel(pin);
+	ADCSRB = (ADCSRB & ~(1 << MUX5)) | (((pin >> 3) & 0x01) << MUX5);
+#elif defined(ADCSRB) && defined(MUX5)
+	ADCSRB = (ADCSRB & ~(1 << MUX5)) | (((pin >> 3) & 0x01) << MUX5);
+#endif
+
+#if defined(ADMUX) && defined(ADLAR)
+	// left-adjust, so ADCH holds the top 8 bits
+	ADMUX = (analog_reference << 6) | (1 << ADLAR) | (pin & 0x07);
+#endif
+
+#if defined(ADCSRA) && defined(ADCH)
+	uint8_t prescaler = ADCSRA & ADC_PRESCALER_MASK;
+	ADCSRA = (ADCSRA & ~ADC_PRESCALER_MASK) | ADC_PRESCALER_FAST;
+	sbi(ADCSRA, ADSC);
+	while (bit_is_set(ADCSRA, ADSC));
+	result = ADCH;
+	ADCSRA = (ADCSRA & ~ADC_PRESCALER_MASK) | prescaler;
+#else
+	result = 0;
+#endif
+
+	return result;
+}
+
+// resolution of analogWrite() values and PWM cycle length for the
+// timers analogWriteConfig() (wiring_analog_config.c) can change; init()
+// sets up 8 bits
+#if defined(TCCR1A) && defined(ICR1) && defined(WGM13)
+uint8_t pwm_timer1_bits = 8;
+#if defined(PROFILER)
+uint16_t pwm_timer1_top = 0xFFFF;	// set up by init(), see Profiler.h
+#else
+uint16_t pwm_timer1_top = 255;
+#endif
+#endif
+#if defined(TCCR2B) && defined(OCR2A)
+uint8_t pwm_timer2_bits = 8;
+#endif
+
+// defined in wiring_softpwm.c, linked in with analogWriteConfig()
+uint8_t softPwmWrite(uint8_t pin, int val) __attribute__((weak));
+
 // Right now, PWM output only works on the pins with
 // hardware support.  These are defined in the appropriate
 // pins_*.c file.  For the rest of the pins, we default
-// to digital output.
+// to digital output, unless analogWriteConfig() set up
+// software PWM for them.
 void analogWrite(uint8_t pin, int val)
 {
+	uint8_t timer = digitalPinToTimer(pin);
+	unsigned int max = 255;	// 2^15 - 1 at most
+
+	if (timer == NOT_ON_TIMER && softPwmWrite && softPwmWrite(pin, val)) return;
+#if defined(TCCR1A) && defined(ICR1) && defined(WGM13)
+	if (timer == TIMER1A || timer == TIMER1B) max = (1U << pwm_timer1_bits) - 1;
+#endif
+#if defined(TCCR2B) && defined(OCR2A)
+	if (timer == TIMER2A || timer == TIMER2B) max = (1U << pwm_timer2_bits) - 1;
+#endif
+
 	// We need to make sure the PWM output is enabled for those pins
 	// that support it, as we turn it off when digitally reading or
 	// writing with them.  Also, make sure the pin is in output mode
@@ -109,13 +179,23 @@ void analogWrite(uint8_t pin, int val)
 	{
 		digitalWrite(pin, LOW);
 	}
-	else if (val == 255)
+	else if ((unsigned int)val == max)
 	{
 		digitalWrite(pin, HIGH);
 	}
 	else
 	{
-		switch(digitalPinToTimer(pin))
+		// scale to the PWM cycle analogWriteConfig() set up
+#if defined(TCCR1A) && defined(ICR1) && defined(WGM13)
+		if ((timer == TIMER1A || timer == TIMER1B) && pwm_timer1_top != max)
+			val = ((unsigned long)val * pwm_timer1_top + max / 2) / max;
+#endif
+#if defined(TCCR2B) && defined(OCR2A)
+		if (timer == TIMER2A || timer == TIMER2B)
+			val <<= 8 - pwm_timer2_bits;
+#endif
+
+		switch(timer)
 		{
 			// XXX fix needed for atmega8
 			#if defined(TCCR0) && defined(COM00) && !defined(__AVR_ATmega8__)
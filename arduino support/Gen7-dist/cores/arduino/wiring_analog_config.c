@@ -0,0 +1,125 @@
+/*
+  wiring_analog_config.c - PWM frequency and resolution of analogWrite()
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+// Apart from wiring_analog.c, so the software PWM it refers to gets
+// linked into sketches calling analogWriteConfig() only, not into every
+// sketch using analogRead() or analogWrite().
+
+#include "wiring_private.h"
+#include "pins_arduino.h"
+
+#if defined(TCCR1A) && defined(ICR1) && defined(WGM13)
+// phase correct PWM with TOP = ICR1: f = F_CPU / (2 * N * TOP), so the
+// smallest prescaler N which fits TOP into 16 bits gives the best
+// resolution
+static unsigned long timer1Config(unsigned long freq, uint8_t bits)
+{
+	static const uint16_t prescalers[] = { 1, 8, 64, 256, 1024 };
+	unsigned long top = 0;
+	uint8_t cs;
+
+	if (bits > 15) return 0;
+#if defined(PROFILER)
+	return 0;	// Timer1 is the profiler's time base
+#endif
+	for (cs = 0; cs < 5; cs++) {
+		top = F_CPU / (2UL * prescalers[cs] * freq);
+		if (top <= 0xFFFF) break;
+	}
+	if (cs == 5 || top < (1UL << bits) - 1) return 0;
+
+	uint8_t oldSREG = SREG;
+	cli();
+	// switch the outputs off meanwhile, old duty cycles don't fit the
+	// new cycle
+	OCR1A = 0;
+	OCR1B = 0;
+	TCNT1 = 0;
+	ICR1 = top;
+	TCCR1A = (TCCR1A & ~((1 << WGM11) | (1 << WGM10))) | (1 << WGM11);
+	TCCR1B = (TCCR1B & ~((1 << WGM13) | (1 << WGM12) | (1 << CS12) | (1 << CS11) | (1 << CS10)))
+	         | (1 << WGM13) | (cs + 1);
+	pwm_timer1_bits = bits;
+	pwm_timer1_top = top;
+	SREG = oldSREG;
+
+	return F_CPU / (2UL * prescalers[cs] * top);
+}
+#endif
+
+#if defined(TCCR2B) && defined(OCR2A)
+// 8 bit phase correct PWM, only the prescaler can be chosen:
+// f = F_CPU / (510 * N)
+static unsigned long timer2Config(unsigned long freq, uint8_t bits)
+{
+	static const uint16_t prescalers[] = { 1, 8, 32, 64, 128, 256, 1024 };
+	unsigned long f, best = 0, bestDiff = 0xFFFFFFFF;
+	uint8_t cs, bestCs = 0;
+
+	if (bits > 8) return 0;
+	for (cs = 0; cs < 7; cs++) {
+		f = F_CPU / (510UL * prescalers[cs]);
+		unsigned long diff = f > freq ? f - freq : freq - f;
+		if (diff < bestDiff) {
+			bestDiff = diff;
+			bestCs = cs;
+			best = f;
+		}
+	}
+
+	uint8_t oldSREG = SREG;
+	cli();
+	OCR2A = 0;
+	OCR2B = 0;
+	TCCR2B = (TCCR2B & ~((1 << CS22) | (1 << CS21) | (1 << CS20))) | (bestCs + 1);
+	pwm_timer2_bits = bits;
+	SREG = oldSREG;
+
+	return best;
+}
+#endif
+
+// Sets PWM frequency and resolution of a pin; analogWrite() takes values
+// of 0 to 2^bits - 1 afterwards. Pins of the same timer share the
+// setting. Pins not on a timer get software PWM. Returns the frequency
+// achieved, or 0 if the setting isn't possible; Timer0 can't be changed,
+// as it runs millis(). tone() uses Timer2 and changes its setting.
+unsigned long analogWriteConfig(uint8_t pin, unsigned long freq, uint8_t bits)
+{
+	if (freq == 0 || bits == 0) return 0;
+
+	switch (digitalPinToTimer(pin))
+	{
+#if defined(TCCR1A) && defined(ICR1) && defined(WGM13)
+		case TIMER1A:
+		case TIMER1B:
+			return timer1Config(freq, bits);
+#endif
+#if defined(TCCR2B) && defined(OCR2A)
+		case TIMER2A:
+		case TIMER2B:
+			return timer2Config(freq, bits);
+#endif
+		case NOT_ON_TIMER:
+			return softPwmConfig(pin, freq, bits);
+		default:
+			return 0;
+	}
+}
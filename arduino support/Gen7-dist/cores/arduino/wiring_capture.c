@@ -0,0 +1,192 @@
+/*
+  wiring_capture.c - pulse measurement with the Timer1 input capture unit
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#include "wiring_private.h"
+#include "pins_arduino.h"
+
+#if defined(TIMER1_CAPT_vect) && defined(ICR1)
+
+// Unlike pulseIn(), the hardware latches the timer value on each edge of
+// the ICP1 pin, so the result doesn't depend on what the CPU is doing at
+// that time; interrupts only have to be serviced before the next edge.
+// Timer1 runs at F_CPU / 8 in normal mode, its overflows extend the
+// count to 32 bits.
+
+// the input capture pin, ICP1
+#if defined(__AVR_ATmega644__) || defined(__AVR_ATmega644P__) || defined(__AVR_ATmega1284P__)
+#define CAPTURE_DDR DDRD
+#define CAPTURE_BIT 6
+#elif defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+#define CAPTURE_DDR DDRD
+#define CAPTURE_BIT 4
+#elif defined(__AVR_ATmega8__) || defined(__AVR_ATmega168__) || defined(__AVR_ATmega328P__)
+#define CAPTURE_DDR DDRB
+#define CAPTURE_BIT 0
+#endif
+
+static volatile uint16_t capture_overflows;
+static uint8_t capture_saved_tccr1a, capture_saved_tccr1b, capture_saved_timsk1;
+// analogWriteConfig() may use ICR1 as TOP, and the compare values are
+// the PWM duties, so all of them go back as they were
+static uint16_t capture_saved_icr1, capture_saved_ocr1a, capture_saved_ocr1b;
+
+static uint32_t capture_rise;	// time stamps of the last edges
+static uint32_t capture_fall;
+static uint8_t capture_edges;	// number of edges seen, saturates at 3
+
+static volatile uint32_t capture_high;	// results in timer ticks
+static volatile uint32_t capture_low;
+static volatile uint32_t capture_period;
+static volatile uint8_t capture_new;
+
+void pulseCaptureBegin(void)
+{
+#if defined(PROFILER)
+	return;	// Timer1 is the profiler's time base
+#endif
+	uint8_t oldSREG = SREG;
+	cli();
+
+	capture_saved_tccr1a = TCCR1A;
+	capture_saved_tccr1b = TCCR1B;
+	capture_saved_timsk1 = TIMSK1;
+	capture_saved_icr1 = ICR1;
+	capture_saved_ocr1a = OCR1A;
+	capture_saved_ocr1b = OCR1B;
+
+#if defined(CAPTURE_DDR)
+	cbi(CAPTURE_DDR, CAPTURE_BIT);
+#endif
+
+	// normal mode, noise canceler on, first capture on a rising edge
+	TCCR1A = 0;
+	TCCR1B = (1 << ICNC1) | (1 << ICES1) | (1 << CS11);
+	TCNT1 = 0;
+	capture_overflows = 0;
+	capture_edges = 0;
+	capture_high = capture_low = capture_period = 0;
+	capture_new = 0;
+
+	TIFR1 = (1 << ICF1) | (1 << TOV1);
+	TIMSK1 = (1 << ICIE1) | (1 << TOIE1);
+
+	SREG = oldSREG;
+}
+
+// Gives Timer1 back in the state it had before, so its PWM works again.
+void pulseCaptureEnd(void)
+{
+#if defined(PROFILER)
+	return;
+#endif
+	uint8_t oldSREG = SREG;
+	cli();
+
+	TIMSK1 = capture_saved_timsk1;
+	// stopped while the values go back, so no compare fires in between
+	TCCR1B = 0;
+	ICR1 = capture_saved_icr1;
+	OCR1A = capture_saved_ocr1a;
+	OCR1B = capture_saved_ocr1b;
+	TCNT1 = 0;
+	TIFR1 = (1 << ICF1) | (1 << TOV1) | (1 << OCF1A) | (1 << OCF1B);
+	TCCR1A = capture_saved_tccr1a;
+	TCCR1B = capture_saved_tccr1b;
+
+	SREG = oldSREG;
+}
+
+uint8_t pulseCaptureAvailable(void)
+{
+	return capture_new;
+}
+
+static unsigned long ticksToMicroseconds(uint32_t ticks)
+{
+	// one tick is 8 clock cycles; split to avoid overflowing ticks * 8
+	uint32_t cpm = clockCyclesPerMicrosecond();
+	return (ticks / cpm) * 8 + (ticks % cpm) * 8 / cpm;
+}
+
+static unsigned long captureRead(volatile uint32_t *value)
+{
+	uint32_t ticks;
+	uint8_t oldSREG = SREG;
+
+	cli();
+	ticks = *value;
+	capture_new = 0;
+	SREG = oldSREG;
+
+	return ticksToMicroseconds(ticks);
+}
+
+unsigned long pulseCaptureHigh(void)
+{
+	return captureRead(&capture_high);
+}
+
+unsigned long pulseCaptureLow(void)
+{
+	return captureRead(&capture_low);
+}
+
+unsigned long pulseCapturePeriod(void)
+{
+	return captureRead(&capture_period);
+}
+
+ISR(TIMER1_OVF_vect)
+{
+	capture_overflows++;
+}
+
+ISR(TIMER1_CAPT_vect)
+{
+	uint16_t count = ICR1;
+	uint16_t high = capture_overflows;
+	uint32_t stamp;
+
+	// an overflow may have happened after the capture, but before we
+	// got here; it's still pending then and belongs to this capture only
+	// if the captured count is from before the wrap
+	if ((TIFR1 & (1 << TOV1)) && count < 0x8000) high++;
+	stamp = ((uint32_t)high << 16) | count;
+
+	if (TCCR1B & (1 << ICES1)) {
+		if (capture_edges >= 2) capture_period = stamp - capture_rise;
+		if (capture_edges >= 1) capture_low = stamp - capture_fall;
+		capture_rise = stamp;
+		TCCR1B &= ~(1 << ICES1);
+	} else {
+		if (capture_edges >= 1) {
+			capture_high = stamp - capture_rise;
+			capture_new = 1;
+		}
+		capture_fall = stamp;
+		TCCR1B |= (1 << ICES1);
+	}
+	if (capture_edges < 3) capture_edges++;
+
+	// changing the edge may set the flag, see the datasheet
+	TIFR1 = (1 << ICF1);
+}
+
+#endif
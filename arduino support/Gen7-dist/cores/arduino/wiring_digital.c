@@ -176,3 +176,80 @@ int digitalRead(uint8_t pin)
 	if (*portInputRegister(port) & bit) return HIGH;
 	return LOW;
 }
+
+// Resolves pin into its port registers and bit mask. Returns 0 for an
+// invalid pin, in which case fp points to a dummy register, so using it
+// is harmless.
+uint8_t pinResolve(FastPin *fp, uint8_t pin)
+{
+	static volatile uint8_t dummy;
+	uint8_t timer, port;
+
+	if (pin >= NUM_DIGITAL_PINS || (port = digitalPinToPort(pin)) == NOT_A_PIN) {
+		fp->out = fp->in = &dummy;
+		fp->mask = 0;
+		return 0;
+	}
+
+	timer = digitalPinToTimer(pin);
+	if (timer != NOT_ON_TIMER) turnOffPWM(timer);
+
+	fp->out = portOutputRegister(port);
+	fp->in = portInputRegister(port);
+	fp->mask = digitalPinToBitMask(pin);
+	return 1;
+}
+
+// Groups count pins by their output port. Pins have to be set to OUTPUT
+// separately. Returns 0 if there are too many pins or an invalid one.
+uint8_t pinGroupInit(PinGroup *g, const uint8_t *pins, uint8_t count)
+{
+	FastPin fp;
+	uint8_t i, p;
+
+	g->count = 0;
+	g->ports = 0;
+	if (count > PIN_GROUP_MAX_PINS) return 0;
+
+	for (i = 0; i < count; i++) {
+		if (!pinResolve(&fp, pins[i])) return 0;
+
+		for (p = 0; p < g->ports; p++) {
+			if (g->out[p] == fp.out) break;
+		}
+		if (p == g->ports) {
+			if (p >= PIN_GROUP_MAX_PORTS) return 0;
+			g->out[p] = fp.out;
+			g->portMask[p] = 0;
+			g->ports++;
+		}
+		g->portMask[p] |= fp.mask;
+		g->pinPort[i] = p;
+		g->pinMask[i] = fp.mask;
+	}
+	g->count = count;
+	return 1;
+}
+
+void pinGroupWrite(const PinGroup *g, uint8_t select, uint8_t values)
+{
+	uint8_t mask[PIN_GROUP_MAX_PORTS] = { 0 };
+	uint8_t set[PIN_GROUP_MAX_PORTS] = { 0 };
+	uint8_t i;
+
+	// translate to port bits first, to keep the time between the writes
+	// to different ports as short as possible
+	for (i = 0; i < g->count; i++, select >>= 1, values >>= 1) {
+		if (select & 1) {
+			mask[g->pinPort[i]] |= g->pinMask[i];
+			if (values & 1) set[g->pinPort[i]] |= g->pinMask[i];
+		}
+	}
+
+	uint8_t oldSREG = SREG;
+	cli();
+	for (i = 0; i < g->ports; i++) {
+		if (mask[i]) *g->out[i] = (*g->out[i] & ~mask[i]) | set[i];
+	}
+	SREG = oldSREG;
+}
@@ -31,6 +31,7 @@
 #include <stdarg.h>
 
 #include "Arduino.h"
+#include "Profiler.h"
 
 #ifdef __cplusplus
 extern "C"{
@@ -62,6 +63,58 @@ extern "C"{
 #define EXTERNAL_NUM_INTERRUPTS 2
 #endif
 
+// analogRead() and friends accept both channel and pin numbers; pin
+// numbers start here
+#if defined(PORTL) // 100 pin chips
+#define ANALOG_PIN_OFFSET 54
+#elif defined(__AVR_ATmega32U4__)
+#define ANALOG_PIN_OFFSET 18
+#elif defined(PORTA) // 40/44 pin chips
+#define ANALOG_PIN_OFFSET 24
+#else
+#define ANALOG_PIN_OFFSET 14
+#endif
+
+extern uint8_t analog_reference;
+
+// The ADC needs a clock of 50-200 kHz for full 10 bit resolution; up to
+// about 1 MHz still gives 8 good bits. ADC_PRESCALER_FOR() gives the
+// ADPS bits for the smallest division keeping the clock at or below
+// maxHz; it folds to a constant.
+#ifndef ADC_MAX_CLOCK
+#define ADC_MAX_CLOCK 200000L
+#endif
+#ifndef ADC_MAX_CLOCK_FAST
+#define ADC_MAX_CLOCK_FAST 1000000L
+#endif
+
+#define ADC_PRESCALER_FOR(maxHz) \
+	((F_CPU / 2 <= (maxHz)) ? 1 : \
+	 (F_CPU / 4 <= (maxHz)) ? 2 : \
+	 (F_CPU / 8 <= (maxHz)) ? 3 : \
+	 (F_CPU / 16 <= (maxHz)) ? 4 : \
+	 (F_CPU / 32 <= (maxHz)) ? 5 : \
+	 (F_CPU / 64 <= (maxHz)) ? 6 : 7)
+
+#define ADC_PRESCALER ADC_PRESCALER_FOR(ADC_MAX_CLOCK)
+#define ADC_PRESCALER_FAST ADC_PRESCALER_FOR(ADC_MAX_CLOCK_FAST)
+#define ADC_PRESCALER_MASK ((1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0))
+
+// software PWM for pins not on a timer, see wiring_softpwm.c
+#ifndef SOFT_PWM_CHANNELS
+#define SOFT_PWM_CHANNELS 8
+#endif
+unsigned long softPwmConfig(uint8_t pin, unsigned long freq, uint8_t bits);
+
+// PWM resolution set by analogWriteConfig(), in wiring_analog.c
+#if defined(TCCR1A) && defined(ICR1) && defined(WGM13)
+extern uint8_t pwm_timer1_bits;
+extern uint16_t pwm_timer1_top;
+#endif
+#if defined(TCCR2B) && defined(OCR2A)
+extern uint8_t pwm_timer2_bits;
+#endif
+
 typedef void (*voidFuncPtr)(void);
 
 #ifdef __cplusplus
@@ -1,5 +1,5 @@
 /*
-  wiring_shift.c - shiftOut() function
+  wiring_shift.c - shiftOut() and shiftIn() functions
   Part of Arduino - http://www.arduino.cc/
 
   Copyright (c) 2005-2006 David A. Mellis
@@ -23,33 +23,138 @@
 */
 
 #include "wiring_private.h"
+#include "pins_arduino.h"
+
+#if defined(SPCR) && defined(SPIF)
+
+// Shifting on the SPI pins is done by the SPI hardware, at F_CPU / 8.
+// This needs SS to be an output, as a low level on an SS input would
+// switch the SPI into slave mode. shiftIn() clocks out zeros on MOSI.
+static uint8_t spiUsable(uint8_t dataPin, uint8_t spiDataPin, uint8_t clockPin)
+{
+	return dataPin == spiDataPin && clockPin == SCK &&
+	       (*portModeRegister(digitalPinToPort(SS)) & digitalPinToBitMask(SS));
+}
+
+// Sets up the SPI like the bit-banged code clocks: clock idles low;
+// shiftOut() changes data before the rising edge (mode 0), shiftIn()
+// reads while the clock is high (mode 1). Returns the SPCR and SPSR
+// bits to restore, in case the SPI library uses the SPI, too.
+static uint16_t spiBegin(uint8_t bitOrder, uint8_t cpha)
+{
+	uint16_t saved = (SPCR << 8) | (SPSR & (1 << SPI2X));
+
+	SPCR = (1 << SPE) | (1 << MSTR) | cpha | (1 << SPR0) |
+	       (bitOrder == LSBFIRST ? (1 << DORD) : 0);
+	SPSR |= (1 << SPI2X);
+	return saved;
+}
+
+static void spiEnd(uint16_t saved)
+{
+	SPCR = saved >> 8;
+	SPSR = (SPSR & ~(1 << SPI2X)) | (saved & (1 << SPI2X));
+}
+
+#endif
+
+void shiftOutBuf(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, const uint8_t *buf, size_t len)
+{
+	if (len == 0) return;
+
+#if defined(SPCR) && defined(SPIF)
+	if (spiUsable(dataPin, MOSI, clockPin)) {
+		uint16_t saved = spiBegin(bitOrder, 0);
+		uint8_t next = *buf++;
+
+		SPDR = next;
+		while (--len) {
+			// fetch the next byte while the current one shifts out
+			next = *buf++;
+			while (!(SPSR & (1 << SPIF)));
+			SPDR = next;
+		}
+		while (!(SPSR & (1 << SPIF)));
+		spiEnd(saved);
+		return;
+	}
+#endif
+
+	FastPin data, clock;
+	uint8_t i, val;
+
+	if (!pinResolve(&data, dataPin) || !pinResolve(&clock, clockPin)) return;
+
+	while (len--) {
+		val = *buf++;
+		for (i = 0; i < 8; i++) {
+			if (bitOrder == LSBFIRST) {
+				fastPinWrite(&data, val & 1);
+				val >>= 1;
+			} else {
+				fastPinWrite(&data, val & 0x80);
+				val <<= 1;
+			}
+			fastPinHigh(&clock);
+			fastPinLow(&clock);
+		}
+	}
+}
+
+void shiftInBuf(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t *buf, size_t len)
+{
+	if (len == 0) return;
+
+#if defined(SPCR) && defined(SPIF)
+	if (spiUsable(dataPin, MISO, clockPin)) {
+		uint16_t saved = spiBegin(bitOrder, (1 << CPHA));
+
+		SPDR = 0;
+		while (--len) {
+			while (!(SPSR & (1 << SPIF)));
+			uint8_t val = SPDR;
+			// start the next byte before storing this one
+			SPDR = 0;
+			*buf++ = val;
+		}
+		while (!(SPSR & (1 << SPIF)));
+		*buf = SPDR;
+		spiEnd(saved);
+		return;
+	}
+#endif
+
+	FastPin data, clock;
+	uint8_t i, val;
+
+	if (!pinResolve(&data, dataPin) || !pinResolve(&clock, clockPin)) {
+		// no pins, nothing read
+		memset(buf, 0, len);
+		return;
+	}
+
+	while (len--) {
+		val = 0;
+		for (i = 0; i < 8; i++) {
+			fastPinHigh(&clock);
+			if (bitOrder == LSBFIRST)
+				val |= (fastPinRead(&data) ? 1 : 0) << i;
+			else
+				val |= (fastPinRead(&data) ? 1 : 0) << (7 - i);
+			fastPinLow(&clock);
+		}
+		*buf++ = val;
+	}
+}
 
 uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder) {
 	uint8_t value = 0;
-	uint8_t i;
-
-	for (i = 0; i < 8; ++i) {
-		digitalWrite(clockPin, HIGH);
-		if (bitOrder == LSBFIRST)
-			value |= digitalRead(dataPin) << i;
-		else
-			value |= digitalRead(dataPin) << (7 - i);
-		digitalWrite(clockPin, LOW);
-	}
+
+	shiftInBuf(dataPin, clockPin, bitOrder, &value, 1);
 	return value;
 }
 
 void shiftOut(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder, uint8_t val)
 {
-	uint8_t i;
-
-	for (i = 0; i < 8; i++)  {
-		if (bitOrder == LSBFIRST)
-			digitalWrite(dataPin, !!(val & (1 << i)));
-		else	
-			digitalWrite(dataPin, !!(val & (1 << (7 - i))));
-			
-		digitalWrite(clockPin, HIGH);
-		digitalWrite(clockPin, LOW);		
-	}
+	shiftOutBuf(dataPin, clockPin, bitOrder, &val, 1);
 }
@@ -0,0 +1,211 @@
+/*
+  wiring_softpwm.c - software PWM for pins without a timer output
+  Part of Arduino - http://www.arduino.cc/
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General
+  Public License along with this library; if not, write to the
+  Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+  Boston, MA  02111-1307  USA
+*/
+
+#include "wiring_private.h"
+#include "pins_arduino.h"
+
+#if defined(TIMER0_COMPB_vect) && defined(OCIE0B)
+
+// The tick is the Timer0 compare B match, which happens once per Timer0
+// cycle whatever OCR0B is set to, so analogWrite() on the OC0B pin still
+// works. That's F_CPU / 64 / 256: 977 Hz at 16 MHz, 1221 Hz at 20 MHz.
+// Slow, but just right for heater MOSFETs, which heat up when switched
+// fast.
+#define SOFT_PWM_TICK_HZ (F_CPU / 64 / 256)
+
+// All channels share one PWM cycle, like the outputs of a hardware timer.
+// Instead of looking at every channel on every tick, the interrupt works
+// from a table sorted by switch-off time: at the start of a cycle it
+// raises all channels with one write per port, then on each tick it only
+// compares the tick count with the time of the next event. Channels
+// switching off at the same tick share an event, so the interrupt costs
+// the same no matter how many channels there are, except for the few
+// ticks with an event. The table is rebuilt outside of the interrupt and
+// swapped in at the start of a cycle.
+
+#define SOFT_PWM_PORTS 4
+
+typedef struct {
+	uint8_t time;			// tick of the cycle to switch off at
+	uint8_t off[SOFT_PWM_PORTS];	// port bits to clear
+} SoftPwmEvent;
+
+typedef struct {
+	uint8_t period;			// ticks per cycle, 2 to 255
+	uint8_t events;
+	uint8_t on[SOFT_PWM_PORTS];	// port bits to set at the cycle start
+	SoftPwmEvent event[SOFT_PWM_CHANNELS];
+} SoftPwmTable;
+
+typedef struct {
+	uint8_t pin;
+	uint8_t port;		// index into soft_pwm_out
+	uint8_t mask;
+	int value;		// as passed to analogWrite()
+	unsigned int max;	// largest analogWrite() value
+} SoftPwmChannel;
+
+static SoftPwmChannel soft_pwm[SOFT_PWM_CHANNELS];
+static uint8_t soft_pwm_count;
+static volatile uint8_t *soft_pwm_out[SOFT_PWM_PORTS];
+static uint8_t soft_pwm_ports;
+static uint8_t soft_pwm_period = 255;
+
+static SoftPwmTable soft_pwm_table[2];
+static volatile uint8_t soft_pwm_active;	// table used by the interrupt
+static volatile uint8_t soft_pwm_pending;	// the other one is ready
+
+// Builds the inactive table from the channel settings. Clearing the
+// pending flag first keeps the interrupt from swapping tables meanwhile.
+static void softPwmRebuild(void)
+{
+	SoftPwmTable *t;
+	uint8_t i, j, p, duty;
+
+	soft_pwm_pending = 0;
+	t = &soft_pwm_table[soft_pwm_active ^ 1];
+
+	t->period = soft_pwm_period;
+	t->events = 0;
+	for (p = 0; p < SOFT_PWM_PORTS; p++) t->on[p] = 0;
+
+	for (i = 0; i < soft_pwm_count; i++) {
+		SoftPwmChannel *c = &soft_pwm[i];
+
+		duty = ((unsigned long)c->value * t->period + c->max / 2) / c->max;
+		if (duty == 0) continue;
+		t->on[c->port] |= c->mask;
+		if (duty >= t->period) continue;	// never switched off
+
+		// insert into the events, sorted by time
+		for (j = 0; j < t->events && t->event[j].time < duty; j++);
+		if (j == t->events || t->event[j].time != duty) {
+			SoftPwmEvent *e;
+			for (e = &t->event[t->events]; e > &t->event[j]; e--) *e = e[-1];
+			t->event[j].time = duty;
+			for (p = 0; p < SOFT_PWM_PORTS; p++) t->event[j].off[p] = 0;
+			t->events++;
+		}
+		t->event[j].off[c->port] |= c->mask;
+	}
+
+	soft_pwm_pending = 1;
+}
+
+unsigned long softPwmConfig(uint8_t pin, unsigned long freq, uint8_t bits)
+{
+	FastPin fp;
+	SoftPwmChannel *c;
+	unsigned long period;
+	uint8_t i, p;
+
+	if (bits > 15) return 0;
+
+	for (i = 0; i < soft_pwm_count; i++) {
+		if (soft_pwm[i].pin == pin) break;
+	}
+	if (i == SOFT_PWM_CHANNELS) return 0;
+	if (!pinResolve(&fp, pin)) return 0;
+
+	for (p = 0; p < soft_pwm_ports; p++) {
+		if (soft_pwm_out[p] == fp.out) break;
+	}
+	if (p == SOFT_PWM_PORTS) return 0;
+
+	period = (SOFT_PWM_TICK_HZ + freq / 2) / freq;
+	if (period < 2) period = 2;
+	if (period > 255) period = 255;
+	soft_pwm_period = period;
+
+	if (p == soft_pwm_ports) {
+		soft_pwm_out[p] = fp.out;
+		soft_pwm_ports++;
+	}
+	c = &soft_pwm[i];
+	c->pin = pin;
+	c->port = p;
+	c->mask = fp.mask;
+	c->value = 0;
+	c->max = (1U << bits) - 1;
+	if (i == soft_pwm_count) soft_pwm_count++;
+
+	fastPinLow(&fp);
+	pinMode(pin, OUTPUT);
+	softPwmRebuild();
+	TIMSK0 |= (1 << OCIE0B);
+
+	return SOFT_PWM_TICK_HZ / period;
+}
+
+uint8_t softPwmWrite(uint8_t pin, int val)
+{
+	uint8_t i;
+
+	for (i = 0; i < soft_pwm_count; i++) {
+		if (soft_pwm[i].pin == pin) {
+			SoftPwmChannel *c = &soft_pwm[i];
+			if (val < 0) val = 0;
+			if ((unsigned int)val > c->max) val = c->max;
+			c->value = val;
+			softPwmRebuild();
+			return 1;
+		}
+	}
+	return 0;
+}
+
+ISR(TIMER0_COMPB_vect)
+{
+	static uint8_t count, next;
+	SoftPwmTable *t;
+	uint8_t p;
+
+	if (count == 0) {
+		if (soft_pwm_pending) {
+			soft_pwm_active ^= 1;
+			soft_pwm_pending = 0;
+		}
+		t = &soft_pwm_table[soft_pwm_active];
+		for (p = 0; p < soft_pwm_ports; p++) {
+			if (t->on[p]) *soft_pwm_out[p] |= t->on[p];
+		}
+		next = 0;
+	} else {
+		t = &soft_pwm_table[soft_pwm_active];
+	}
+
+	while (next < t->events && t->event[next].time == count) {
+		for (p = 0; p < soft_pwm_ports; p++) {
+			*soft_pwm_out[p] &= ~t->event[next].off[p];
+		}
+		next++;
+	}
+
+	if (++count >= t->period) count = 0;
+}
+
+#else
+
+unsigned long softPwmConfig(uint8_t pin, unsigned long freq, uint8_t bits)
+{
+	return 0;
+}
+
+#endif
@@ -56,10 +56,20 @@ static const uint8_t A5 = 29;
 static const uint8_t A6 = 20;
 static const uint8_t A7 = 21;
 
-#define digitalPinToPCICR(p)    (((p) >= 0 && (p) <= 33) ? (&PCICR) : ((uint8_t *)0))
-#define digitalPinToPCICRbit(p) (((p) <= 9) ? 2 : (((p) <= 23) ? 0 : 1))
-#define digitalPinToPCMSK(p)    (((p) <= 9) ? (&PCMSK2) : (((p) <= 23) ? (&PCMSK0) : (((p) <= 33) ? (&PCMSK1) : ((uint8_t *)0))))
-#define digitalPinToPCMSKbit(p) (((p) <= 9) ? (p) : (((p) <= 23) ? ((p) - 10) : ((p) - 24)))
+// PCINT0-7 are port A, 8-15 port B, 16-23 port C, 24-31 port D; the
+// PCMSK bit is the port bit.
+#define digitalPinToPCICR(p)    (((p) >= 0 && (p) <= 31) ? (&PCICR) : ((uint8_t *)0))
+#define digitalPinToPCICRbit(p) (((p) <= 7) ? 1 : (((p) <= 15) ? 3 : (((p) <= 23) ? 2 : 0)))
+#define digitalPinToPCMSK(p)    (((p) <= 7) ? (&PCMSK1) : (((p) <= 15) ? (&PCMSK3) : (((p) <= 23) ? (&PCMSK2) : (((p) <= 31) ? (&PCMSK0) : ((uint8_t *)0)))))
+#define digitalPinToPCMSKbit(p) (((p) <= 7) ? (p) : (((p) <= 15) ? ((p) - 8) : (((p) <= 23) ? ((p) - 16) : (31 - (p)))))
+
+// Compile time equivalents of the tables below, used by digitalWriteFast()
+// and friends. They have to match digital_pin_to_port_PGM[] and
+// digital_pin_to_bit_mask_PGM[]. Note the reversed bit order on port A.
+#define digitalPinToPortReg(p)  (((p) <= 7) ? &PORTB : (((p) <= 15) ? &PORTD : (((p) <= 23) ? &PORTC : &PORTA)))
+#define digitalPinToDDRReg(p)   (((p) <= 7) ? &DDRB : (((p) <= 15) ? &DDRD : (((p) <= 23) ? &DDRC : &DDRA)))
+#define digitalPinToPINReg(p)   (((p) <= 7) ? &PINB : (((p) <= 15) ? &PIND : (((p) <= 23) ? &PINC : &PINA)))
+#define digitalPinToBit(p)      (((p) <= 7) ? (p) : (((p) <= 15) ? (p) - 8 : (((p) <= 23) ? (p) - 16 : 31 - (p))))
 
 #ifdef ARDUINO_MAIN
 
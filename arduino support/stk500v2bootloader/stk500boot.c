@@ -67,6 +67,7 @@ LICENSE:
 #include <avr/io.h>
 #include <avr/interrupt.h>
 #include <avr/boot.h>
+#include <avr/wdt.h>
 #include <avr/pgmspace.h>
 #include "command.h"
 
@@ -316,6 +317,16 @@ static void sendchar(char c);
 static unsigned char recchar(void);
 
 
+/*
+ * MCUSR as found after reset, handed to the application in r2. r3 holds
+ * the marker and r4 the complement of r2, so the application can tell it
+ * from what r2 happens to hold after a power on without this bootloader.
+ * Watchdog.c of the Gen7 core checks the same marker.
+ */
+#define RESET_CAUSE_MARKER 0xB7
+static uint8_t resetCause;
+
+
 /*
  * since this bootloader is not linked against the avr-gcc crt1 functions,
  * to reduce the code size, we need to provide our own initialization
@@ -334,6 +345,15 @@ void __jumpMain(void)
 
     asm volatile ( "clr __zero_reg__" );                       // GCC depends on register r1 set to 0
     asm volatile ( "out %0, __zero_reg__" :: "I" (_SFR_IO_ADDR(SREG)) );  // set SREG to 0
+
+    /*
+     * After a watchdog reset the watchdog keeps running with its shortest
+     * timeout, and would reset us again while we wait for the programmer.
+     * WDRF has to be cleared before it can be turned off.
+     */
+    resetCause = MCUSR;
+    MCUSR = 0;
+    wdt_disable();
 #if ! defined(REMOVE_PROG_PIN_PULLUP) || defined(ALWAYS_WAIT_FOR_PROGRAMMER)
     PROG_PORT |= (1<<PROG_PIN);                                // Enable internal pullup
 #endif
@@ -834,12 +854,19 @@ int main(void)
 
     // Jump to Reset vector in Application Section
     // (clear register, push this register to the stack twice = adress 0x0000/words, and return to this address)
+    // The reset cause goes along in r2, with the marker in r3 and its
+    // complement in r4; the application's startup code doesn't touch them.
     asm volatile (
+        "mov r2, %0" "\n\t"
+        "mov r4, %0" "\n\t"
+        "com r4" "\n\t"
+        "ldi r24, %1" "\n\t"
+        "mov r3, r24" "\n\t"
         "clr r1" "\n\t"
         "push r1" "\n\t"
         "push r1" "\n\t"
         "ret"     "\n\t"
-    ::);
+    :: "r" (resetCause), "M" (RESET_CAUSE_MARKER) : "r24");
 
      /*
      * Never return to stop GCC to generate exit return code
@@ -0,0 +1,31 @@
+/*
+  Mock of <avr/interrupt.h> for host builds. sei() and cli() set and
+  clear the I bit of the mocked SREG, so the core's atomic sections
+  (oldSREG = SREG; cli(); ... SREG = oldSREG;) behave as on the chip.
+  An ISR is an ordinary function of the vector's name.
+*/
+
+#ifndef _AVR_INTERRUPT_H_
+#define _AVR_INTERRUPT_H_
+
+#include <avr/io.h>
+
+#define sei() (SREG |= _BV(SREG_I))
+#define cli() (SREG &= ~_BV(SREG_I))
+
+#ifdef __cplusplus
+#define ISR_EXTC extern "C"
+#else
+#define ISR_EXTC
+#endif
+
+#define ISR_BLOCK
+#define ISR_NOBLOCK
+#define ISR_NAKED
+#define ISR_ALIASOF(v)
+#define ISR(vector, ...) ISR_EXTC void vector(void); void vector(void)
+#define SIGNAL(vector) ISR(vector)
+#define EMPTY_INTERRUPT(vector) ISR(vector) {}
+#define reti()
+
+#endif
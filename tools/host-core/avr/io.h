@@ -0,0 +1,285 @@
+/*
+  Mock of <avr/io.h> for host builds of the Gen7 Arduino core. The I/O
+  registers of the ATmega644P are bytes of host_sfr[], indexed by their
+  data space address, so core code reading and writing registers runs
+  unchanged and tests can inspect or preset them. Interrupt vectors are
+  plain functions, a test raises an interrupt by calling e.g.
+  USART0_RX_vect().
+
+  Only the registers and bits the core uses are listed.
+*/
+
+#ifndef _AVR_IO_H_
+#define _AVR_IO_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+extern volatile uint8_t host_sfr[0x100];
+#ifdef __cplusplus
+}
+#endif
+
+#define _BV(b) (1 << (b))
+#define _SFR_MEM8(a) (host_sfr[a])
+#define _SFR_MEM16(a) (*(volatile uint16_t *)&host_sfr[a])
+#define _SFR_IO8(a) _SFR_MEM8((a) + 0x20)
+#define _SFR_BYTE(s) (s)
+#define _SFR_ADDR(s) ((uint16_t)(&(s) - host_sfr))
+#define _SFR_IO_ADDR(s) (_SFR_ADDR(s) - 0x20)
+#define bit_is_set(s,b) ((s) & _BV(b))
+#define bit_is_clear(s,b) (!((s) & _BV(b)))
+#define loop_until_bit_is_set(s,b) do {} while (bit_is_clear(s,b))
+#define PINA _SFR_IO8(0x00)
+#define DDRA _SFR_IO8(0x01)
+#define PORTA _SFR_IO8(0x02)
+#define PINB _SFR_IO8(0x03)
+#define DDRB _SFR_IO8(0x04)
+#define PORTB _SFR_IO8(0x05)
+#define PINC _SFR_IO8(0x06)
+#define DDRC _SFR_IO8(0x07)
+#define PORTC _SFR_IO8(0x08)
+#define PIND _SFR_IO8(0x09)
+#define DDRD _SFR_IO8(0x0A)
+#define PORTD _SFR_IO8(0x0B)
+#define TIFR0 _SFR_IO8(0x15)
+#define TOV0 0
+#define OCF0A 1
+#define OCF0B 2
+#define TIFR1 _SFR_IO8(0x16)
+#define TOV1 0
+#define OCF1A 1
+#define OCF1B 2
+#define ICF1 5
+#define TIFR2 _SFR_IO8(0x17)
+#define TOV2 0
+#define OCF2A 1
+#define OCF2B 2
+#define PCIFR _SFR_IO8(0x1B)
+#define PCIF0 0
+#define PCIF1 1
+#define PCIF2 2
+#define PCIF3 3
+#define EIFR _SFR_IO8(0x1C)
+#define EIMSK _SFR_IO8(0x1D)
+#define INT0 0
+#define INT1 1
+#define INT2 2
+#define GPIOR0 _SFR_IO8(0x1E)
+#define GTCCR _SFR_IO8(0x23)
+#define PSRSYNC 0
+#define TSM 7
+#define TCCR0A _SFR_IO8(0x24)
+#define WGM00 0
+#define WGM01 1
+#define COM0B0 4
+#define COM0B1 5
+#define COM0A0 6
+#define COM0A1 7
+#define TCCR0B _SFR_IO8(0x25)
+#define CS00 0
+#define CS01 1
+#define CS02 2
+#define WGM02 3
+#define TCNT0 _SFR_IO8(0x26)
+#define OCR0A _SFR_IO8(0x27)
+#define OCR0B _SFR_IO8(0x28)
+#define GPIOR1 _SFR_IO8(0x2A)
+#define GPIOR2 _SFR_IO8(0x2B)
+#define SPCR _SFR_IO8(0x2C)
+#define SPR0 0
+#define SPR1 1
+#define CPHA 2
+#define CPOL 3
+#define MSTR 4
+#define DORD 5
+#define SPE 6
+#define SPIE 7
+#define SPSR _SFR_IO8(0x2D)
+#define SPI2X 0
+#define WCOL 6
+#define SPIF 7
+#define SPDR _SFR_IO8(0x2E)
+#define SMCR _SFR_IO8(0x33)
+#define SE 0
+#define SM0 1
+#define SM1 2
+#define SM2 3
+#define MCUSR _SFR_IO8(0x34)
+#define PORF 0
+#define EXTRF 1
+#define BORF 2
+#define WDRF 3
+#define MCUCR _SFR_IO8(0x35)
+#define SPL _SFR_IO8(0x3D)
+#define SPH _SFR_IO8(0x3E)
+#define SP _SFR_MEM16(0x5D)
+#define SREG _SFR_IO8(0x3F)
+#define SREG_I 7
+#define WDTCSR _SFR_MEM8(0x60)
+#define WDP0 0
+#define WDP1 1
+#define WDP2 2
+#define WDE 3
+#define WDCE 4
+#define WDP3 5
+#define WDIE 6
+#define WDIF 7
+#define PRR0 _SFR_MEM8(0x64)
+#define PCICR _SFR_MEM8(0x68)
+#define PCIE0 0
+#define PCIE1 1
+#define PCIE2 2
+#define PCIE3 3
+#define EICRA _SFR_MEM8(0x69)
+#define ISC00 0
+#define ISC01 1
+#define ISC10 2
+#define ISC11 3
+#define ISC20 4
+#define ISC21 5
+#define PCMSK0 _SFR_MEM8(0x6B)
+#define PCMSK1 _SFR_MEM8(0x6C)
+#define PCMSK2 _SFR_MEM8(0x6D)
+#define PCMSK3 _SFR_MEM8(0x73)
+#define TIMSK0 _SFR_MEM8(0x6E)
+#define TOIE0 0
+#define OCIE0A 1
+#define OCIE0B 2
+#define TIMSK1 _SFR_MEM8(0x6F)
+#define TOIE1 0
+#define OCIE1A 1
+#define OCIE1B 2
+#define ICIE1 5
+#define TIMSK2 _SFR_MEM8(0x70)
+#define TOIE2 0
+#define OCIE2A 1
+#define OCIE2B 2
+#define ADC _SFR_MEM16(0x78)
+#define ADCW _SFR_MEM16(0x78)
+#define ADCL _SFR_MEM8(0x78)
+#define ADCH _SFR_MEM8(0x79)
+#define ADCSRA _SFR_MEM8(0x7A)
+#define ADPS0 0
+#define ADPS1 1
+#define ADPS2 2
+#define ADIE 3
+#define ADIF 4
+#define ADATE 5
+#define ADSC 6
+#define ADEN 7
+#define ADCSRB _SFR_MEM8(0x7B)
+#define ADTS0 0
+#define ADTS1 1
+#define ADTS2 2
+#define ACME 6
+#define ADMUX _SFR_MEM8(0x7C)
+#define MUX0 0
+#define ADLAR 5
+#define REFS0 6
+#define REFS1 7
+#define DIDR0 _SFR_MEM8(0x7E)
+#define TCCR1A _SFR_MEM8(0x80)
+#define WGM10 0
+#define WGM11 1
+#define COM1B0 4
+#define COM1B1 5
+#define COM1A0 6
+#define COM1A1 7
+#define TCCR1B _SFR_MEM8(0x81)
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define WGM12 3
+#define WGM13 4
+#define ICES1 6
+#define ICNC1 7
+#define TCCR1C _SFR_MEM8(0x82)
+#define TCNT1 _SFR_MEM16(0x84)
+#define ICR1 _SFR_MEM16(0x86)
+#define OCR1A _SFR_MEM16(0x88)
+#define OCR1B _SFR_MEM16(0x8A)
+#define TCCR2A _SFR_MEM8(0xB0)
+#define WGM20 0
+#define WGM21 1
+#define COM2B0 4
+#define COM2B1 5
+#define COM2A0 6
+#define COM2A1 7
+#define TCCR2B _SFR_MEM8(0xB1)
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define WGM22 3
+#define TCNT2 _SFR_MEM8(0xB2)
+#define OCR2A _SFR_MEM8(0xB3)
+#define OCR2B _SFR_MEM8(0xB4)
+#define ASSR _SFR_MEM8(0xB6)
+#define UCSR0A _SFR_MEM8(0xC0)
+#define MPCM0 0
+#define U2X0 1
+#define UPE0 2
+#define DOR0 3
+#define FE0 4
+#define UDRE0 5
+#define TXC0 6
+#define RXC0 7
+#define UCSR0B _SFR_MEM8(0xC1)
+#define TXB80 0
+#define RXB80 1
+#define UCSZ02 2
+#define TXEN0 3
+#define RXEN0 4
+#define UDRIE0 5
+#define TXCIE0 6
+#define RXCIE0 7
+#define UCSR0C _SFR_MEM8(0xC2)
+#define UBRR0L _SFR_MEM8(0xC4)
+#define UBRR0H _SFR_MEM8(0xC5)
+#define UDR0 _SFR_MEM8(0xC6)
+#define UCSR1A _SFR_MEM8(0xC8)
+#define U2X1 1
+#define UPE1 2
+#define TXC1 6
+#define UCSR1B _SFR_MEM8(0xC9)
+#define TXEN1 3
+#define RXEN1 4
+#define UDRIE1 5
+#define RXCIE1 7
+#define UCSR1C _SFR_MEM8(0xCA)
+#define UBRR1L _SFR_MEM8(0xCC)
+#define UBRR1H _SFR_MEM8(0xCD)
+#define UDR1 _SFR_MEM8(0xCE)
+#define RAMSTART 0x100
+#define RAMEND 0x10FF
+#define INT0_vect INT0_vect
+#define INT1_vect INT1_vect
+#define INT2_vect INT2_vect
+#define PCINT0_vect PCINT0_vect
+#define PCINT1_vect PCINT1_vect
+#define PCINT2_vect PCINT2_vect
+#define PCINT3_vect PCINT3_vect
+#define WDT_vect WDT_vect
+#define TIMER2_COMPA_vect TIMER2_COMPA_vect
+#define TIMER2_COMPB_vect TIMER2_COMPB_vect
+#define TIMER2_OVF_vect TIMER2_OVF_vect
+#define TIMER1_CAPT_vect TIMER1_CAPT_vect
+#define TIMER1_COMPA_vect TIMER1_COMPA_vect
+#define TIMER1_COMPB_vect TIMER1_COMPB_vect
+#define TIMER1_OVF_vect TIMER1_OVF_vect
+#define TIMER0_COMPA_vect TIMER0_COMPA_vect
+#define TIMER0_COMPB_vect TIMER0_COMPB_vect
+#define TIMER0_OVF_vect TIMER0_OVF_vect
+#define SPI_STC_vect SPI_STC_vect
+#define USART0_RX_vect USART0_RX_vect
+#define USART0_UDRE_vect USART0_UDRE_vect
+#define USART0_TX_vect USART0_TX_vect
+#define ANALOG_COMP_vect ANALOG_COMP_vect
+#define ADC_vect ADC_vect
+#define USART1_RX_vect USART1_RX_vect
+#define USART1_UDRE_vect USART1_UDRE_vect
+#define SIG_INTERRUPT2 INT2_vect
+
+#endif
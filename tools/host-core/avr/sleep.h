@@ -0,0 +1,29 @@
+/*
+  Mock of <avr/sleep.h> for host builds. sleep_cpu() hands over to
+  host_sleep() of host.c, which lets mocked time pass until the next
+  interrupt, so delay() and friends terminate.
+*/
+
+#ifndef _AVR_SLEEP_H_
+#define _AVR_SLEEP_H_
+
+#include <avr/io.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+void host_sleep(void);
+#ifdef __cplusplus
+}
+#endif
+
+#define SLEEP_MODE_IDLE 0
+#define SLEEP_MODE_PWR_DOWN (_BV(SM1))
+
+#define set_sleep_mode(m) (SMCR = (SMCR & ~(_BV(SM0) | _BV(SM1) | _BV(SM2))) | (m))
+#define sleep_enable() (SMCR |= _BV(SE))
+#define sleep_disable() (SMCR &= ~_BV(SE))
+#define sleep_cpu() host_sleep()
+#define sleep_mode() do { sleep_enable(); sleep_cpu(); sleep_disable(); } while (0)
+
+#endif
@@ -0,0 +1,26 @@
+/*
+  Mock of <avr/wdt.h> for host builds. The watchdog never bites, tests
+  look at WDTCSR to see how it was configured.
+*/
+
+#ifndef _AVR_WDT_H_
+#define _AVR_WDT_H_
+
+#include <avr/io.h>
+
+#define wdt_reset() ((void)0)
+#define wdt_disable() (WDTCSR = 0)
+#define wdt_enable(v) (WDTCSR = _BV(WDE) | ((v) & 0x08 ? _BV(WDP3) : 0) | ((v) & 0x07))
+
+#define WDTO_15MS 0
+#define WDTO_30MS 1
+#define WDTO_60MS 2
+#define WDTO_120MS 3
+#define WDTO_250MS 4
+#define WDTO_500MS 5
+#define WDTO_1S 6
+#define WDTO_2S 7
+#define WDTO_4S 8
+#define WDTO_8S 9
+
+#endif
@@ -0,0 +1,167 @@
+/*
+  A minimal benchmark harness with the API of Google Benchmark, as far as
+  core-bench.cpp uses it, so the benchmarks build with nothing but g++ and
+  can move over to the real library unchanged:
+
+    static void BM_Something(benchmark::State &state) {
+      while (state.KeepRunning())
+        benchmark::DoNotOptimize(something(state.range(0)));
+    }
+    BENCHMARK(BM_Something)->Arg(80)->Arg(120);
+    BENCHMARK_MAIN();
+
+  Each benchmark runs with a doubling iteration count until it took at
+  least 0.2 seconds, then reports wall time per iteration.
+
+  Permission to use, copy, modify, and/or distribute this software for
+  any purpose with or without fee is hereby granted, provided that the
+  above copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+  WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+  BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+  OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+  WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+  ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+  SOFTWARE.
+*/
+
+#ifndef bench_h
+#define bench_h
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+namespace benchmark {
+
+template <class T>
+inline void DoNotOptimize(T const &value)
+{
+	__asm__ __volatile__ ("" : : "r,m" (value) : "memory");
+}
+
+inline void ClobberMemory(void)
+{
+	__asm__ __volatile__ ("" : : : "memory");
+}
+
+class State
+{
+public:
+	State(unsigned long iterations, long arg)
+		: todo(iterations), arg(arg), label(0) {}
+
+	bool KeepRunning(void) {return todo-- > 0;}
+	long range(int) const {return arg;}
+	void SetLabel(const char *text) {label = text;}
+
+	const char *Label(void) const {return label;}
+
+private:
+	unsigned long todo;
+	long arg;
+	const char *label;
+};
+
+typedef void (*Function)(State &);
+
+class Benchmark
+{
+public:
+	Benchmark(const char *name, Function fn) : name(name), fn(fn), nargs(0) {}
+
+	Benchmark *Arg(long a) {
+		if (nargs < sizeof(args) / sizeof(args[0]))
+			args[nargs++] = a;
+		return this;
+	}
+
+	void Run(void) const {
+		if (nargs == 0)
+			RunOne(false, 0);
+		for (unsigned i = 0; i < nargs; i++)
+			RunOne(true, args[i]);
+	}
+
+private:
+	static double Now(void) {
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return ts.tv_sec + ts.tv_nsec * 1e-9;
+	}
+
+	void RunOne(bool hasArg, long arg) const {
+		char title[64];
+		unsigned long iterations = 1;
+		double elapsed;
+		const char *label;
+
+		for (;;) {
+			State state(iterations, arg);
+			double start = Now();
+			fn(state);
+			elapsed = Now() - start;
+			label = state.Label();
+			if (elapsed >= 0.2 || iterations >= 1000000000UL)
+				break;
+			iterations *= 2;
+		}
+
+		if (hasArg)
+			snprintf(title, sizeof(title), "%s/%ld", name, arg);
+		else
+			snprintf(title, sizeof(title), "%s", name);
+		printf("%-36s %10.1f ns %12lu %s\n", title,
+		       elapsed * 1e9 / iterations, iterations, label ? label : "");
+	}
+
+	const char *name;
+	Function fn;
+	long args[8];
+	unsigned nargs;
+};
+
+// no STL here, Arduino.h's min() and max() macros break it
+struct Registry
+{
+	Benchmark *list[64];
+	unsigned count;
+};
+
+inline Registry &Benchmarks(void)
+{
+	static Registry registry;
+	return registry;
+}
+
+inline Benchmark *Register(const char *name, Function fn)
+{
+	Benchmark *b = new Benchmark(name, fn);
+	Registry &r = Benchmarks();
+	if (r.count < sizeof(r.list) / sizeof(r.list[0]))
+		r.list[r.count++] = b;
+	return b;
+}
+
+inline void RunSpecifiedBenchmarks(void)
+{
+	Registry &r = Benchmarks();
+	printf("%-36s %13s %12s\n", "Benchmark", "Time", "Iterations");
+	for (unsigned i = 0; i < r.count; i++)
+		r.list[i]->Run();
+}
+
+}  // namespace benchmark
+
+#define BENCHMARK_CONCAT2(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT2(a, b)
+#define BENCHMARK(fn) \
+	static benchmark::Benchmark *BENCHMARK_CONCAT(benchmark_, __LINE__) \
+		__attribute__((unused)) = benchmark::Register(#fn, fn)
+#define BENCHMARK_MAIN() \
+	int main(void) {benchmark::RunSpecifiedBenchmarks(); return 0;} \
+	typedef int benchmark_main_unused
+
+#endif
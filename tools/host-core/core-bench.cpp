@@ -0,0 +1,258 @@
+/*
+  Benchmarks for formatting, parsing and String operations of the Gen7
+  Arduino core, run on the host. Timings compare implementations against
+  each other, they don't tell how fast the ATmega runs them.
+
+  Permission to use, copy, modify, and/or distribute this software for
+  any purpose with or without fee is hereby granted, provided that the
+  above copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+  WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+  BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+  OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+  WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+  ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+  SOFTWARE.
+*/
+
+#include "Arduino.h"
+#include "FixedString.h"
+#include "bench.h"
+
+
+// A Print throwing its output away.
+class NullPrint : public Print
+{
+public:
+	virtual size_t write(uint8_t) {return 1;}
+};
+
+// A Stream reading from a string, rewindable.
+class StringStream : public Stream
+{
+public:
+	StringStream(const char *s) : start(s), data(s) {setTimeout(0);}
+	virtual int available(void) {return strlen(data);}
+	virtual int read(void) {return *data ? *data++ : -1;}
+	virtual int peek(void) {return *data ? *data : -1;}
+	virtual void flush(void) {}
+	virtual size_t write(uint8_t) {return 0;}
+	void rewind(void) {data = start;}
+private:
+	const char *start;
+	const char *data;
+};
+
+static const char gLine[] = "G1 X123.456 Y-78.9 Z0.35 E1.2345 F4800";
+
+
+// formatting
+
+static void BM_PrintLong(benchmark::State &state)
+{
+	NullPrint p;
+	long n = 1234567;
+	while (state.KeepRunning())
+		p.print(n);
+}
+BENCHMARK(BM_PrintLong);
+
+static void BM_PrintHex(benchmark::State &state)
+{
+	NullPrint p;
+	unsigned long n = 0xDEADBEEFUL;
+	while (state.KeepRunning())
+		p.print(n, HEX);
+}
+BENCHMARK(BM_PrintHex);
+
+static void BM_PrintFloat(benchmark::State &state)
+{
+	NullPrint p;
+	double x = 123.456;
+	while (state.KeepRunning())
+		p.print(x, 3);
+}
+BENCHMARK(BM_PrintFloat);
+
+
+// parsing
+
+static void BM_ParseInt(benchmark::State &state)
+{
+	StringStream s("X12345 ");
+	while (state.KeepRunning()) {
+		s.rewind();
+		benchmark::DoNotOptimize(s.parseInt());
+	}
+}
+BENCHMARK(BM_ParseInt);
+
+static void BM_ParseFloat(benchmark::State &state)
+{
+	StringStream s("X123.456 ");
+	while (state.KeepRunning()) {
+		s.rewind();
+		benchmark::DoNotOptimize(s.parseFloat());
+	}
+}
+BENCHMARK(BM_ParseFloat);
+
+static void BM_ParseFixed(benchmark::State &state)
+{
+	StringStream s("X123.456 ");
+	while (state.KeepRunning()) {
+		s.rewind();
+		benchmark::DoNotOptimize(s.parseFixed(3));
+	}
+}
+BENCHMARK(BM_ParseFixed);
+
+// all five numbers of a G1 move
+static void BM_ParseGcodeLine(benchmark::State &state)
+{
+	StringStream s(gLine);
+	while (state.KeepRunning()) {
+		s.rewind();
+		for (int i = 0; i < 5; i++)
+			benchmark::DoNotOptimize(s.parseFixed(3));
+	}
+}
+BENCHMARK(BM_ParseGcodeLine);
+
+
+// String and FixedString
+
+static void BM_StringAppendChars(benchmark::State &state)
+{
+	while (state.KeepRunning()) {
+		String s;
+		for (const char *c = gLine; *c; c++)
+			s += *c;
+		benchmark::DoNotOptimize(s.length());
+	}
+}
+BENCHMARK(BM_StringAppendChars);
+
+// Growth policy on G-code lines of typical length, appended character by
+// character as Stream::readString() does. Exact growth (a reserve() of one
+// more character for each append) is what String did before growing
+// geometrically, reserve() up front is the lower bound.
+
+// realloc() calls, counted by the linker wrap of the Makefile
+static unsigned long gReallocs = 0;
+
+extern "C" void *__real_realloc(void *p, size_t size);
+extern "C" void *__wrap_realloc(void *p, size_t size)
+{
+	gReallocs++;
+	return __real_realloc(p, size);
+}
+
+static void gcodeLine(char *buf, long length)
+{
+	static const char words[] = "G1 X123.456 Y-78.901 Z0.350 E1.23456 F4800 ";
+	for (long i = 0; i < length; i++)
+		buf[i] = words[i % (sizeof(words) - 1)];
+	buf[length] = 0;
+}
+
+enum Growth { GEOMETRIC, EXACT, RESERVED };
+
+static void appendLine(String &s, const char *line, long length, Growth growth)
+{
+	if (growth == RESERVED)
+		s.reserve(length);
+	for (const char *c = line; *c; c++) {
+		if (growth == EXACT)
+			s.reserve(s.length() + 1);
+		s += *c;
+	}
+}
+
+static void growthBenchmark(benchmark::State &state, Growth growth)
+{
+	static char label[32];
+	char line[256];
+	long length = state.range(0);
+
+	gcodeLine(line, length);
+	{
+		String s;
+		unsigned long before = gReallocs;
+		appendLine(s, line, length, growth);
+		snprintf(label, sizeof(label), "%lu reallocs",
+		         gReallocs - before);
+	}
+	state.SetLabel(label);
+
+	while (state.KeepRunning()) {
+		String s;
+		appendLine(s, line, length, growth);
+		benchmark::DoNotOptimize(s.length());
+	}
+}
+
+static void BM_StringGrowthGeometric(benchmark::State &state)
+{
+	growthBenchmark(state, GEOMETRIC);
+}
+BENCHMARK(BM_StringGrowthGeometric)->Arg(80)->Arg(100)->Arg(120);
+
+static void BM_StringGrowthExact(benchmark::State &state)
+{
+	growthBenchmark(state, EXACT);
+}
+BENCHMARK(BM_StringGrowthExact)->Arg(80)->Arg(100)->Arg(120);
+
+static void BM_StringGrowthReserved(benchmark::State &state)
+{
+	growthBenchmark(state, RESERVED);
+}
+BENCHMARK(BM_StringGrowthReserved)->Arg(80)->Arg(100)->Arg(120);
+
+static void BM_FixedStringAppendChars(benchmark::State &state)
+{
+	while (state.KeepRunning()) {
+		FixedString<64> s;
+		for (const char *c = gLine; *c; c++)
+			s += *c;
+		benchmark::DoNotOptimize(s.length());
+	}
+}
+BENCHMARK(BM_FixedStringAppendChars);
+
+static void BM_StringBuildReply(benchmark::State &state)
+{
+	int temp = 210;
+	while (state.KeepRunning()) {
+		String s = String("ok T:") + temp + " /" + 215 + " B:" + 60;
+		benchmark::DoNotOptimize(s.length());
+	}
+}
+BENCHMARK(BM_StringBuildReply);
+
+static void BM_StringFindValue(benchmark::State &state)
+{
+	String line(gLine);
+	while (state.KeepRunning()) {
+		int i = line.indexOf('F');
+		benchmark::DoNotOptimize(line.substring(i + 1).toInt());
+	}
+}
+BENCHMARK(BM_StringFindValue);
+
+static void BM_StringViewFindValue(benchmark::State &state)
+{
+	StringView line(gLine);
+	while (state.KeepRunning()) {
+		int i = line.indexOf('F');
+		benchmark::DoNotOptimize(line.substring(i + 1).toInt());
+	}
+}
+BENCHMARK(BM_StringViewFindValue);
+
+
+BENCHMARK_MAIN();
@@ -0,0 +1,231 @@
+/*
+  Scenarios for the Gen7 Arduino core on mocked time: Timer0 drives
+  millis() and micros(), the UART receives G-code at the real baud rate.
+  Built once per clock frequency, as the timing code differs between
+  them. Each scenario reports the interrupts it took, so changes in
+  interrupt load show up.
+
+  Permission to use, copy, modify, and/or distribute this software for
+  any purpose with or without fee is hereby granted, provided that the
+  above copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+  WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+  BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+  OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+  WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+  ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+  SOFTWARE.
+*/
+
+#include <stdio.h>
+#include "Arduino.h"
+
+
+#define MHZ (F_CPU / 1000000L)
+
+static int gFailures = 0;
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+static bool check(bool ok, const char *what, int line)
+{
+	if ( ! ok) {
+		gFailures++;
+		fprintf(stderr, "core-scenarios.cpp:%d: check failed: %s\n",
+		        line, what);
+	}
+	return ok;
+}
+
+static void report(const char *scenario)
+{
+	printf("%-28s %8lu Timer0 %6lu RX %6lu UDRE interrupts\n", scenario,
+	       host_interrupts.timer0_ovf, host_interrupts.usart0_rx,
+	       host_interrupts.usart0_udre);
+}
+
+// what a sketch's loop costs between two calls of yield() by delay()
+extern "C" void yield(void)
+{
+	host_advance(16);
+}
+
+
+// millis(), micros() and cycles64() over a minute of running Timer0
+static void timerDrift(void)
+{
+	const unsigned long seconds = 60;
+
+	host_reset();
+	init();
+	unsigned long m = millis();
+	unsigned long u = micros();
+	uint64_t c = cycles64();
+	uint64_t start = host_cycles;
+
+	for (unsigned long i = 0; i < seconds * 1000; i++)
+		host_advance(F_CPU / 1000);
+
+	long dm = millis() - m;
+	long du = micros() - u;
+	uint64_t dc = cycles64() - c;
+	uint64_t elapsed = host_cycles - start;
+
+	CHECK(dm >= (long)(seconds * 1000 - 1) && dm <= (long)(seconds * 1000));
+	CHECK(du >= (long)(seconds * 1000000 - 64 / MHZ - 1) &&
+	      du <= (long)(seconds * 1000000 + 64 / MHZ + 1));
+	CHECK(dc + 64 > elapsed && dc < elapsed + 64);
+	CHECK(host_interrupts.timer0_ovf == elapsed / (64 * 256) ||
+	      host_interrupts.timer0_ovf == elapsed / (64 * 256) + 1);
+	report("timer drift over 60 s");
+}
+
+// micros() accounts for an overflow which is pending, because
+// interrupts are disabled
+static void pendingOverflow(void)
+{
+	host_reset();
+	init();
+	while (TCNT0 != 250)
+		host_advance(64);
+	unsigned long u1 = micros();
+
+	cli();
+	host_advance(10 * 64);
+	CHECK(TIFR0 & _BV(TOV0));
+	unsigned long u2 = micros();
+	sei();
+	host_advance(64);
+	unsigned long u3 = micros();
+
+	CHECK(u2 - u1 >= 10 * 64 / MHZ - 1 && u2 - u1 <= 10 * 64 / MHZ + 1);
+	CHECK(u3 - u2 >= 64 / MHZ - 1 && u3 - u2 <= 64 / MHZ + 1);
+	report("pending Timer0 overflow");
+}
+
+// micros64() divides in 32 bit steps, or shifts; check it against a
+// plain 64 bit division far into the count
+extern "C" volatile unsigned long timer0_overflow_count;
+extern "C" volatile unsigned int timer0_overflow_count_high;
+
+static void micros64Range(void)
+{
+	static const unsigned int high[] = { 0, 1, 0x1234, 0xFFFF };
+
+	host_reset();
+	init();
+	for (unsigned i = 0; i < sizeof(high) / sizeof(high[0]); i++) {
+		timer0_overflow_count_high = high[i];
+		timer0_overflow_count = 0x89ABCDEFUL;
+		host_advance(12345);
+		uint64_t c = cycles64();
+		CHECK(c >> 46 == high[i]);
+		CHECK(micros64() == c / MHZ);
+	}
+	report("micros64() over 48 bits");
+}
+
+// delay() neither returns early nor oversleeps. It measures with micros(),
+// so it may end one micros() step (64 cycles) early.
+static void delayAccuracy(void)
+{
+	static const unsigned long ms[] = { 1, 2, 10, 250, 1000 };
+
+	host_reset();
+	init();
+	host_advance(1234);  // somewhere in the middle of a tick
+
+	for (unsigned i = 0; i < sizeof(ms) / sizeof(ms[0]); i++) {
+		uint64_t start = host_cycles;
+		delay(ms[i]);
+		uint64_t us = (host_cycles - start) / MHZ;
+		if ( ! CHECK(us + 64 / MHZ >= ms[i] * 1000 &&
+		             us <= ms[i] * 1000 + 20))
+			fprintf(stderr, "  delay(%lu) took %lu us\n", ms[i],
+			        (unsigned long)us);
+	}
+	report("delay() accuracy");
+}
+
+// A host sends G-code at 115200 baud, the sketch collects lines and
+// answers each with "ok", spending workMs after each look at the input.
+// Returns the number of lines received intact.
+static int gcodeStream(unsigned long workMs)
+{
+	static const char gcode[] =
+		"G28\n"
+		"G1 X10.5 Y20.25 F3000\n"
+		"G1 X110.5 Y20.25 E1.234\n"
+		"G1 X110.5 Y120.25 E2.468\n"
+		"M104 S210\n"
+		"M105\n"
+		"G1 X10.5 Y120.25 E3.702\n"
+		"G1 X10.5 Y20.25 E4.936\n"
+		"M106 S255\n"
+		"G1 Z0.35 F600\n";
+	char expected[sizeof(gcode)];
+	char line[64];
+	unsigned int len = 0;
+	int lines = 0, intact = 0;
+
+	host_reset();
+	init();
+	Serial.begin(115200);
+	host_uart_receive(gcode);
+
+	strcpy(expected, gcode);
+	char *next = strtok(expected, "\n");
+	while (host_cycles < 2 * (uint64_t)F_CPU) {
+		while (Serial.available()) {
+			char c = Serial.read();
+			if (c != '\n') {
+				if (len < sizeof(line) - 1)
+					line[len++] = c;
+				continue;
+			}
+			line[len] = '\0';
+			len = 0;
+			lines++;
+			if (next && strcmp(line, next) == 0)
+				intact++;
+			next = next ? strtok(NULL, "\n") : NULL;
+			Serial.print("ok\n");
+		}
+		delay(workMs);
+	}
+	CHECK(host_uart_sent_len == 3 * (unsigned)lines);
+	return intact;
+}
+
+static void serialInput(void)
+{
+	char title[40];
+
+	// 5 ms is ~58 characters at 115200 baud, the 64 byte buffer keeps up
+	CHECK(gcodeStream(5) == 10);
+	report("G-code, 5 ms per loop");
+
+	// 20 ms overflows it
+	int intact = gcodeStream(20);
+	CHECK(intact < 10);
+	snprintf(title, sizeof(title), "G-code, 20 ms (%d/10 intact)", intact);
+	report(title);
+}
+
+
+int main(void)
+{
+	printf("scenarios at %ld MHz\n", MHZ);
+
+	timerDrift();
+	pendingOverflow();
+	micros64Range();
+	delayAccuracy();
+	serialInput();
+
+	if (gFailures)
+		printf("%d failures\n", gFailures);
+	return gFailures ? 1 : 0;
+}
@@ -0,0 +1,288 @@
+/*
+  Unit tests for the hardware independent parts of the Gen7 Arduino core,
+  run on the host. See host.h for the differences to the chip.
+
+  Permission to use, copy, modify, and/or distribute this software for
+  any purpose with or without fee is hereby granted, provided that the
+  above copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+  WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+  BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+  OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+  WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+  ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+  SOFTWARE.
+*/
+
+#include <stdio.h>
+#include "Arduino.h"
+#include "FixedString.h"
+
+
+static int gChecks = 0;
+static int gFailures = 0;
+
+#define CHECK(cond) check((cond), #cond, __FILE__, __LINE__)
+#define CHECK_STR(actual, expected) \
+	check(strcmp((actual), (expected)) == 0, #actual " == " #expected, \
+	      __FILE__, __LINE__)
+
+static void check(bool ok, const char *what, const char *file, int line)
+{
+	gChecks++;
+	if ( ! ok) {
+		gFailures++;
+		fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+	}
+}
+
+// A Print collecting its output in memory.
+class BufferPrint : public Print
+{
+public:
+	BufferPrint() : len(0) {buf[0] = 0;}
+	virtual size_t write(uint8_t c) {
+		if (len + 1 >= sizeof(buf))
+			return 0;
+		buf[len++] = c;
+		buf[len] = 0;
+		return 1;
+	}
+	const char *str(void) const {return buf;}
+	void clear(void) {len = 0; buf[0] = 0;}
+private:
+	char buf[128];
+	size_t len;
+};
+
+// A Stream reading from a string.
+class StringStream : public Stream
+{
+public:
+	StringStream(const char *s) : data(s) {setTimeout(0);}
+	virtual int available(void) {return strlen(data);}
+	virtual int read(void) {return *data ? *data++ : -1;}
+	virtual int peek(void) {return *data ? *data : -1;}
+	virtual void flush(void) {}
+	virtual size_t write(uint8_t) {return 0;}
+	const char *rest(void) const {return data;}
+private:
+	const char *data;
+};
+
+
+static void testPrint(void)
+{
+	BufferPrint p;
+
+	p.print(0);
+	p.print(' ');
+	p.print(-123);
+	p.print(' ');
+	p.print(4000000000UL);
+	CHECK_STR(p.str(), "0 -123 4000000000");
+
+	p.clear();
+	p.print(255, HEX);
+	p.print(' ');
+	p.print(5, BIN);
+	p.print(' ');
+	p.print(8, OCT);
+	CHECK_STR(p.str(), "FF 101 10");
+
+	p.clear();
+	p.print(1.5);
+	p.print(' ');
+	p.print(-0.125, 3);
+	p.print(' ');
+	p.print(2.0 / 3.0, 4);
+	CHECK_STR(p.str(), "1.50 -0.125 0.6667");
+
+	p.clear();
+	p.print(F("G1 X"));
+	p.println(10);
+	CHECK_STR(p.str(), "G1 X10\r\n");
+}
+
+static void testStreamParsing(void)
+{
+	StringStream s1("X12 Y-7 Z3.25 F");
+	CHECK(s1.parseInt() == 12);
+	CHECK(s1.parseInt() == -7);
+	CHECK(s1.parseFloat() == 3.25f);
+	CHECK(s1.parseInt() == 0);  // nothing numeric left
+
+	StringStream s2("E-1.0005 ");
+	CHECK(s2.parseFixed(3) == -1001);
+
+	StringStream s3("G28 X0\nM104 S200\n");
+	char line[32];
+	size_t n = s3.readBytesUntil('\n', line, sizeof(line) - 1);
+	line[n] = 0;
+	CHECK_STR(line, "G28 X0");
+	CHECK_STR(s3.rest(), "M104 S200\n");
+
+	FixedString<4> fs;
+	CHECK(s3.readBytesUntil('\n', fs) == 4);
+	CHECK_STR(fs.c_str(), "M104");
+
+	StringStream s4("ok T:210.0 /210.0 B:60.0");
+	CHECK(s4.findUntil((char *)"B:", (char *)"\n"));
+	CHECK(s4.parseFloat() == 60.0f);
+}
+
+static void testString(void)
+{
+	String s("G1");
+	s += ' ';
+	s += 'X';
+	s += 12;
+	s += " F";
+	s += 3000UL;
+	CHECK(s == "G1 X12 F3000");
+	CHECK(s.length() == 12);
+	CHECK(s.indexOf('X') == 3);
+	CHECK(s.indexOf("F") == 7);
+	CHECK(s.substring(4, 6) == "12");
+	CHECK(s.substring(8).toInt() == 3000);
+
+	String t = String("a") + 1 + 'b' + 2UL;
+	CHECK(t == "a1b2");
+
+	String u("  Hello World  ");
+	u.trim();
+	u.toUpperCase();
+	u.replace("WORLD", "GEN7");
+	CHECK(u == "HELLO GEN7");
+
+	CHECK(String(255, HEX) == "ff");
+	CHECK(String(-42) == "-42");
+	CHECK(String('c') == "c");
+
+	// appending char by char keeps the contents intact through growth
+	String v;
+	for (int i = 0; i < 200; i++)
+		v += (char)('a' + i % 26);
+	CHECK(v.length() == 200);
+	CHECK(v.charAt(199) == 'a' + 199 % 26);
+	v.shrinkToFit();
+	CHECK(v.length() == 200);
+	CHECK(v.startsWith("abcdef"));
+
+	CHECK(v.reserve(300));
+	CHECK(v.length() == 200);
+}
+
+static void testFixedString(void)
+{
+	FixedString<8> f("G1");
+	CHECK(f.capacity() == 8);
+	CHECK(f.concat(" X10"));
+	CHECK_STR(f.c_str(), "G1 X10");
+	CHECK( ! f.concat("000"));  // doesn't fit, unchanged
+	CHECK_STR(f.c_str(), "G1 X10");
+	CHECK(f.concat(7));
+	CHECK_STR(f.c_str(), "G1 X107");
+
+	// views into the string itself, which the replacing moves around
+	FixedString<16> r("ab-cd-");
+	CHECK(r.replace("-", r.substring(0, 2)));
+	CHECK_STR(r.c_str(), "ababcdab");
+	FixedString<16> q("xyxy");
+	CHECK(q.replace(q.substring(0, 1), "zz"));
+	CHECK_STR(q.c_str(), "zzyzzy");
+
+	StringView v("  M104 S200  ");
+	StringView w = v.trimmed();
+	CHECK(w.length() == 9);
+	CHECK(w.startsWith("M104"));
+	CHECK(w.substring(6).toInt() == 200);
+	CHECK(w.lastIndexOf('S') == 5);
+}
+
+static void testSerialRing(void)
+{
+	host_reset();
+	Serial.begin(115200);
+	CHECK(UCSR0B & _BV(RXEN0));
+	CHECK(UCSR0B & _BV(RXCIE0));
+	CHECK(UBRR0L == 16 && (UCSR0A & _BV(U2X0)));  // 115200 baud at 16 MHz
+
+	// received bytes arrive through the ISR
+	const char *in = "M105\n";
+	for (const char *c = in; *c; c++) {
+		UDR0 = *c;
+		USART0_RX_vect();
+	}
+	CHECK(Serial.available() == 5);
+	CHECK(Serial.peek() == 'M');
+	CHECK(Serial.read() == 'M');
+	CHECK(Serial.available() == 4);
+
+	// bytes with parity errors are dropped
+	UCSR0A |= _BV(UPE0);
+	UDR0 = 'x';
+	USART0_RX_vect();
+	UCSR0A &= ~_BV(UPE0);
+	CHECK(Serial.available() == 4);
+
+	while (Serial.read() >= 0)
+		;
+	CHECK(Serial.available() == 0);
+	CHECK(Serial.read() == -1);
+
+	// the ring keeps one slot free, the excess gets dropped
+	for (int i = 0; i < 100; i++) {
+		UDR0 = (uint8_t)i;
+		USART0_RX_vect();
+	}
+	CHECK(Serial.available() == 63);
+	CHECK(Serial.read() == 0);
+	while (Serial.read() >= 0)
+		;
+
+	// sending queues bytes and enables the UDRE interrupt, which feeds UDR0
+	CHECK(Serial.print("ok") == 2);
+	CHECK(UCSR0B & _BV(UDRIE0));
+	USART0_UDRE_vect();
+	CHECK(UDR0 == 'o');
+	USART0_UDRE_vect();
+	CHECK(UDR0 == 'k');
+	USART0_UDRE_vect();
+	CHECK( ! (UCSR0B & _BV(UDRIE0)));  // buffer empty, interrupt off
+
+	Serial.end();
+	CHECK( ! (UCSR0B & _BV(RXEN0)));
+}
+
+static void testMath(void)
+{
+	CHECK(map(512, 0, 1023, 0, 255) == 127);
+	CHECK(map(10, 0, 100, 100, 0) == 90);
+	CHECK(constrain(300, 0, 255) == 255);
+
+	randomSeed(42);
+	for (int i = 0; i < 1000; i++) {
+		long r = random(10, 20);
+		if (r < 10 || r >= 20) {
+			CHECK(r >= 10 && r < 20);
+			break;
+		}
+	}
+}
+
+
+int main(void)
+{
+	testPrint();
+	testStreamParsing();
+	testString();
+	testFixedString();
+	testSerialRing();
+	testMath();
+
+	printf("%d checks, %d failures\n", gChecks, gFailures);
+	return gFailures ? 1 : 0;
+}
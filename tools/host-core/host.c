@@ -0,0 +1,234 @@
+/*
+  Host support for the Gen7 Arduino core, see host.h.
+
+  Permission to use, copy, modify, and/or distribute this software for
+  any purpose with or without fee is hereby granted, provided that the
+  above copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+  WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+  BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+  OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+  WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+  ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+  SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <avr/interrupt.h>
+
+
+volatile uint8_t host_sfr[0x100];
+uint64_t host_cycles;
+struct host_interrupts host_interrupts;
+char host_uart_sent[1024];
+unsigned int host_uart_sent_len;
+
+// cycles since the last Timer0 tick
+static uint32_t timer0_cycles;
+
+// bytes yet to arrive on RXD0, cycles since the last one, cycles until
+// the transmitter is done with the current byte
+static const char *uart_rx;
+static uint32_t uart_rx_cycles;
+static uint32_t uart_tx_cycles;
+
+
+static char *convert(unsigned long value, char *s, int radix, int negative)
+{
+	char buf[8 * sizeof(long) + 2];
+	char *p = buf + sizeof(buf);
+	char *out = s;
+
+	*--p = '\0';
+	do {
+		unsigned digit = value % radix;
+		*--p = digit < 10 ? '0' + digit : 'a' + digit - 10;
+		value /= radix;
+	} while (value);
+	if (negative)
+		*out++ = '-';
+	strcpy(out, p);
+	return s;
+}
+
+// like avr-libc, only radix 10 gets a sign
+char *itoa(int value, char *s, int radix)
+{
+	if (radix == 10 && value < 0)
+		return convert(-(unsigned long)(long)value, s, radix, 1);
+	return convert((unsigned int)value, s, radix, 0);
+}
+
+char *utoa(unsigned int value, char *s, int radix)
+{
+	return convert(value, s, radix, 0);
+}
+
+char *ltoa(long value, char *s, int radix)
+{
+	if (radix == 10 && value < 0)
+		return convert(-(unsigned long)value, s, radix, 1);
+	return convert((unsigned long)value, s, radix, 0);
+}
+
+char *ultoa(unsigned long value, char *s, int radix)
+{
+	return convert(value, s, radix, 0);
+}
+
+char *dtostrf(double value, signed char width, unsigned char prec, char *s)
+{
+	sprintf(s, "%*.*f", width, prec, value);
+	return s;
+}
+
+
+void host_reset(void)
+{
+	memset((void *)host_sfr, 0, sizeof(host_sfr));
+	memset(&host_interrupts, 0, sizeof(host_interrupts));
+	host_cycles = 0;
+	timer0_cycles = 0;
+	uart_rx = NULL;
+	uart_rx_cycles = 0;
+	uart_tx_cycles = 0;
+	host_uart_sent_len = 0;
+	host_uart_sent[0] = '\0';
+}
+
+static uint32_t timer0_prescaler(void)
+{
+	static const uint16_t prescaler[8] = { 0, 1, 8, 64, 256, 1024, 0, 0 };
+
+	return prescaler[TCCR0B & (_BV(CS02) | _BV(CS01) | _BV(CS00))];
+}
+
+static void timer0_tick(void)
+{
+	if (++TCNT0 == 0)
+		TIFR0 |= _BV(TOV0);
+
+	// the chip takes the interrupt as soon as the flag is up
+	if ((TIFR0 & _BV(TOV0)) && (TIMSK0 & _BV(TOIE0)) &&
+	    (SREG & _BV(SREG_I))) {
+		TIFR0 &= ~_BV(TOV0);
+		host_interrupts.timer0_ovf++;
+		cli();
+		TIMER0_OVF_vect();
+		sei();
+	}
+}
+
+void host_uart_receive(const char *data)
+{
+	uart_rx = data;
+	uart_rx_cycles = 0;
+}
+
+// cycles per byte on the line as configured by UBRR0 and U2X0, 8N1
+static uint32_t uart_byte_cycles(void)
+{
+	uint32_t ubrr = ((uint32_t)(UBRR0H & 0x0F) << 8) | UBRR0L;
+
+	return 10 * ((UCSR0A & _BV(U2X0)) ? 8 : 16) * (ubrr + 1);
+}
+
+static void uart_advance(uint32_t cycles)
+{
+	uint32_t byte = uart_byte_cycles();
+
+	if ((UCSR0B & _BV(RXEN0)) && uart_rx && *uart_rx) {
+		uart_rx_cycles += cycles;
+		if (uart_rx_cycles >= byte) {
+			uart_rx_cycles -= byte;
+			UDR0 = *uart_rx++;
+			UCSR0A |= _BV(RXC0);
+			if ((UCSR0B & _BV(RXCIE0)) && (SREG & _BV(SREG_I))) {
+				host_interrupts.usart0_rx++;
+				cli();
+				USART0_RX_vect();
+				sei();
+			}
+			// reading UDR0 clears it, the mock can't tell reads apart
+			UCSR0A &= ~_BV(RXC0);
+		}
+	}
+
+	if ( ! (UCSR0B & _BV(TXEN0)))
+		return;
+	if (uart_tx_cycles > cycles) {
+		uart_tx_cycles -= cycles;
+		return;
+	}
+	uart_tx_cycles = 0;
+	UCSR0A |= _BV(UDRE0);
+	if ((UCSR0B & _BV(UDRIE0)) && (SREG & _BV(SREG_I))) {
+		host_interrupts.usart0_udre++;
+		cli();
+		USART0_UDRE_vect();
+		sei();
+		// HardwareSerial's handler either writes UDR0 or, with nothing
+		// left to send, turns itself off
+		if (UCSR0B & _BV(UDRIE0)) {
+			if (host_uart_sent_len < sizeof(host_uart_sent) - 1) {
+				host_uart_sent[host_uart_sent_len++] = UDR0;
+				host_uart_sent[host_uart_sent_len] = '\0';
+			}
+			uart_tx_cycles = byte;
+		}
+	}
+}
+
+void host_advance(uint32_t cycles)
+{
+	while (cycles) {
+		uint32_t prescaler = timer0_prescaler();
+		uint32_t step = cycles;
+
+		if (prescaler) {
+			// the prescaler may have been switched to a smaller one
+			if (timer0_cycles >= prescaler)
+				timer0_cycles = prescaler - 1;
+			step = prescaler - timer0_cycles;
+		}
+		if (step > cycles)
+			step = cycles;
+		cycles -= step;
+		host_cycles += step;
+
+		uart_advance(step);
+		if (prescaler) {
+			timer0_cycles += step;
+			if (timer0_cycles >= prescaler) {
+				timer0_cycles = 0;
+				timer0_tick();
+			}
+		}
+	}
+}
+
+static unsigned long interrupt_count(void)
+{
+	return host_interrupts.timer0_ovf + host_interrupts.usart0_rx +
+	       host_interrupts.usart0_udre;
+}
+
+void host_sleep(void)
+{
+	unsigned long before = interrupt_count();
+	int timer = timer0_prescaler() && (TIMSK0 & _BV(TOIE0));
+	int rx = (UCSR0B & _BV(RXCIE0)) && uart_rx && *uart_rx;
+	int tx = (UCSR0B & _BV(UDRIE0));
+
+	// nothing would ever wake us up
+	if ( ! (SREG & _BV(SREG_I)) || ! (timer || rx || tx)) {
+		fprintf(stderr, "host_sleep(): sleeping without a wakeup source\n");
+		abort();
+	}
+	while (interrupt_count() == before)
+		host_advance(16);
+}
@@ -0,0 +1,90 @@
+/*
+  Host (x86-64 Linux) support for building the hardware independent parts
+  of the Gen7 Arduino core, for unit tests and benchmarks. The Makefile
+  force-includes this header into every file.
+
+  Differences to the chip worth knowing when reading results: int is 32
+  bits and long is 64 bits here, where avr-gcc has 16 and 32 bits. So
+  e.g. String(-1, HEX) is "ffffffff" instead of "ffff", and millis()
+  doesn't wrap after 49 days. Benchmarks compare algorithms, absolute
+  timings tell nothing about the ATmega.
+
+  Permission to use, copy, modify, and/or distribute this software for
+  any purpose with or without fee is hereby granted, provided that the
+  above copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+  WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+  BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+  OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+  WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+  ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+  SOFTWARE.
+*/
+
+#ifndef host_h
+#define host_h
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// avr-libc's number conversions, missing from glibc
+char *itoa(int value, char *s, int radix);
+char *utoa(unsigned int value, char *s, int radix);
+char *ltoa(long value, char *s, int radix);
+char *ultoa(unsigned long value, char *s, int radix);
+char *dtostrf(double value, signed char width, unsigned char prec, char *s);
+
+// CPU cycles of mocked time passed since host_reset()
+extern uint64_t host_cycles;
+
+// interrupts taken by host_advance()
+struct host_interrupts {
+	unsigned long timer0_ovf;
+	unsigned long usart0_rx;
+	unsigned long usart0_udre;
+};
+extern struct host_interrupts host_interrupts;
+
+// clears all registers, mocked time and the UART line, like a power-on
+// reset
+void host_reset(void);
+
+// lets the given number of CPU cycles pass. Timer0 counts with the
+// prescaler selected in TCCR0B, TIMER0_OVF_vect() runs on overflows.
+// UART0 moves a byte per 10 bit times of the baud rate in UBRR0 and
+// U2X0: received bytes go through USART0_RX_vect(), sent bytes are taken
+// from USART0_UDRE_vect() into host_uart_sent. Interrupts are taken as
+// far as they're enabled, at the granularity of a Timer0 tick.
+//
+// Time passes nowhere else, so code waiting for an interrupt without
+// calling yield() or sleeping (e.g. Serial.write() with a full buffer)
+// never returns on the host.
+void host_advance(uint32_t cycles);
+
+// sleep_cpu(): lets time pass until the next interrupt
+void host_sleep(void);
+
+// starts bytes arriving on RXD0, data has to stay valid until all arrived
+void host_uart_receive(const char *data);
+
+// what went out on TXD0, null terminated
+extern char host_uart_sent[1024];
+extern unsigned int host_uart_sent_len;
+
+// interrupt handlers of the core, call one to raise its interrupt
+void TIMER0_OVF_vect(void);
+void USART0_RX_vect(void);
+void USART0_UDRE_vect(void);
+void USART1_RX_vect(void);
+void USART1_UDRE_vect(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
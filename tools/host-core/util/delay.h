@@ -0,0 +1,11 @@
+/*
+  Mock of <util/delay.h> for host builds: busy waits take no time.
+*/
+
+#ifndef _UTIL_DELAY_H_
+#define _UTIL_DELAY_H_
+
+#define _delay_us(us) ((void)(us))
+#define _delay_ms(ms) ((void)(ms))
+
+#endif
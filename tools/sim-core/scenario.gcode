@@ -0,0 +1,11 @@
+G28
+G1 X10.5 Y20.25 F3000
+G1 X110.5 Y20.25 E1.234
+G1 X110.5 Y120.25 E2.468
+M104 S210
+M105
+G1 X10.5 Y120.25 E3.702
+G1 X10.5 Y20.25 E4.936
+M106 S255
+G1 Z0.35 F600
+M2
@@ -0,0 +1,592 @@
+/*
+  Headless simulator harness for the Gen7 Arduino core and the stk500v2
+  bootloader, on top of simavr. Runs a firmware cycle by cycle and
+  reports the CPU cycles spent per interrupt handler and per API call,
+  optionally comparing them against a baseline from an earlier run.
+
+    sim-core -m atmega644p -f 16000000 [-i script] [-r baseline] app.elf
+    sim-core -m atmega644p -f 16000000 -b [-r baseline] stk500boot.elf
+    sim-core -m atmega644p -f 16000000 -o plain.txt app-profiler.elf
+
+  An application is the scenario sketch, sim-scenarios.cpp. Once it
+  printed "ready", the lines of the script go to its UART at 115200 baud.
+  Interrupt handlers count from the vector to their reti, API calls
+  between the GPIOR0 markers of sim-markers.h.
+
+  With -b the firmware is the bootloader, started at its section like
+  with the BOOTRST fuse set. sim-core talks STK500v2 to it (sign on, read
+  the signature, leave programming mode), then runs it again without
+  input, to time its wait for a programmer.
+
+  Output lines are tab separated:
+    isr   <vector>  <count>  <average cycles>  <maximum cycles>
+    call  <name>    <count>  <average cycles>  <maximum cycles>
+  With -r, averages more than 5% (plus 2 cycles) above the baseline's
+  count as failures and sim-core exits with 1.
+
+  With -o, the firmware is built with -DPROFILER and the reference is the
+  output of the same firmware built without. sim-core prints the cycles
+  the profiler adds to each interrupt handler,
+    overhead  <vector>  <cycles>
+  and fails if one of them is more than MAX_PROFILER_OVERHEAD.
+
+  Permission to use, copy, modify, and/or distribute this software for
+  any purpose with or without fee is hereby granted, provided that the
+  above copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+  WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+  BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+  OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+  WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+  ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+  SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <simavr/sim_avr.h>
+#include <simavr/sim_elf.h>
+#include <simavr/sim_io.h>
+#include <simavr/avr_uart.h>
+
+#define SIM_MARKER_NAMES
+#include "sim-markers.h"
+
+
+#define BAUDRATE 115200
+#define GPIOR0_ADDRESS 0x3E
+#define OPCODE_RETI 0x9518
+#define MAX_VECTORS 35
+#define MAX_NESTING 8
+#define MAX_SECONDS 30
+// PROFILE_ISR_BEGIN()/PROFILE_ISR_END(): two reads of TCNT1, a 16 bit
+// subtraction and store, 14 cycles, plus saving two more registers
+#define MAX_PROFILER_OVERHEAD 24
+
+// ATmega644/644P/1284P, vectors 28 to 30 exist on the P types only,
+// 31 to 34 on the 1284P only
+static const char * const gVectorNames[MAX_VECTORS] = {
+	"RESET", "INT0", "INT1", "INT2", "PCINT0", "PCINT1", "PCINT2",
+	"PCINT3", "WDT", "TIMER2_COMPA", "TIMER2_COMPB", "TIMER2_OVF",
+	"TIMER1_CAPT", "TIMER1_COMPA", "TIMER1_COMPB", "TIMER1_OVF",
+	"TIMER0_COMPA", "TIMER0_COMPB", "TIMER0_OVF", "SPI_STC", "USART0_RX",
+	"USART0_UDRE", "USART0_TX", "ANALOG_COMP", "ADC", "EE_READY", "TWI",
+	"SPM_READY", "USART1_RX", "USART1_UDRE", "USART1_TX", "TIMER3_CAPT",
+	"TIMER3_COMPA", "TIMER3_COMPB", "TIMER3_OVF",
+};
+
+struct stats {
+	unsigned long count;
+	avr_cycle_count_t total;
+	avr_cycle_count_t max;
+};
+
+static struct stats gIsr[MAX_VECTORS];
+static struct stats gCall[SIM_MARKERS];
+static int gFailures = 0;
+
+static void account(struct stats *s, avr_cycle_count_t cycles)
+{
+	s->count++;
+	s->total += cycles;
+	if (cycles > s->max)
+		s->max = cycles;
+}
+
+static unsigned long average(const struct stats *s)
+{
+	return s->count ? (unsigned long)(s->total / s->count) : 0;
+}
+
+
+// the UART line, both directions
+
+static avr_irq_t *gUartIn;
+static char gSent[4096];
+static unsigned int gSentLen = 0;
+static avr_cycle_count_t gSentCycle;	// when the last byte went out
+
+static const unsigned char *gToSend = NULL;
+static unsigned int gToSendLen = 0;
+static avr_cycle_count_t gNextByte;	// when the next byte may go in
+static avr_cycle_count_t gByteCycles;	// 10 bit times
+
+static void uartOutput(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+	avr_t *avr = param;
+
+	if (gSentLen < sizeof(gSent) - 1) {
+		gSent[gSentLen++] = value;
+		gSent[gSentLen] = '\0';
+	}
+	gSentCycle = avr->cycle;
+}
+
+static void uartSetup(avr_t *avr)
+{
+	uint32_t flags = 0;
+
+	// keep simavr from echoing the UART to stdout
+	avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+	flags &= ~AVR_UART_FLAG_STDIO;
+	avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+
+	gUartIn = avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_INPUT);
+	avr_irq_register_notify(
+		avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT),
+		uartOutput, avr);
+	gByteCycles = (avr_cycle_count_t)avr->frequency * 10 / BAUDRATE;
+}
+
+static void uartSend(avr_t *avr, const unsigned char *data, unsigned int len)
+{
+	gToSend = data;
+	gToSendLen = len;
+	gNextByte = avr->cycle;
+}
+
+static void uartFeed(avr_t *avr)
+{
+	if (gToSendLen && avr->cycle >= gNextByte) {
+		avr_raise_irq(gUartIn, *gToSend++);
+		gToSendLen--;
+		gNextByte = avr->cycle + gByteCycles;
+	}
+}
+
+
+// API call markers
+
+static enum sim_marker gMarker = SIM_NONE;
+static avr_cycle_count_t gMarkerCycle;
+
+static void markerWrite(avr_t *avr, avr_io_addr_t addr, uint8_t v, void *param)
+{
+	avr->data[addr] = v;
+	if (gMarker != SIM_NONE)
+		account(&gCall[gMarker], avr->cycle - gMarkerCycle);
+	gMarker = v < SIM_MARKERS ? (enum sim_marker)v : SIM_NONE;
+	gMarkerCycle = avr->cycle;
+}
+
+
+// Runs until the firmware ends, stop() says so or time is up, accounting
+// interrupt handlers on the way. Returns the simavr state.
+static int run(avr_t *avr, int (*stop)(avr_t *))
+{
+	avr_cycle_count_t limit = avr->cycle +
+		(avr_cycle_count_t)avr->frequency * MAX_SECONDS;
+	avr_flashaddr_t table = MAX_VECTORS * avr->vector_size;
+	struct { int vector; avr_cycle_count_t cycle; } nest[MAX_NESTING];
+	int depth = 0;
+	int state = cpu_Running;
+
+	while (state != cpu_Done && state != cpu_Crashed) {
+		avr_flashaddr_t pc = avr->pc;
+		int running = avr->state == cpu_Running;
+		uint16_t opcode = avr->flash[pc] | (avr->flash[pc + 1] << 8);
+
+		state = avr_run(avr);
+
+		if (running && opcode == OPCODE_RETI && depth > 0) {
+			depth--;
+			account(&gIsr[nest[depth].vector],
+			        avr->cycle - nest[depth].cycle);
+		}
+		// an interrupt was taken, the CPU went to its vector
+		if (avr->pc != pc && avr->pc != 0 && avr->pc < table &&
+		    avr->pc % avr->vector_size == 0 && pc >= table &&
+		    depth < MAX_NESTING) {
+			nest[depth].vector = avr->pc / avr->vector_size;
+			nest[depth].cycle = avr->cycle;
+			depth++;
+		}
+
+		uartFeed(avr);
+		if (stop && stop(avr))
+			break;
+		if (avr->cycle > limit) {
+			fprintf(stderr, "sim-core: no end after %d seconds\n",
+			        MAX_SECONDS);
+			gFailures++;
+			break;
+		}
+	}
+	if (state == cpu_Crashed) {
+		fprintf(stderr, "sim-core: firmware crashed at 0x%05x\n",
+		        (unsigned)avr->pc);
+		gFailures++;
+	}
+	return state;
+}
+
+
+// application scenarios
+
+static unsigned char *gScript;
+static long gScriptLen;
+
+static int readyToListen(avr_t *avr)
+{
+	return strstr(gSent, "ready\r\n") != NULL;
+}
+
+static void runApplication(avr_t *avr)
+{
+	avr_register_io_write(avr, GPIOR0_ADDRESS, markerWrite, NULL);
+
+	run(avr, readyToListen);
+	if ( ! readyToListen(avr)) {
+		fprintf(stderr, "sim-core: sketch didn't get ready\n");
+		gFailures++;
+		return;
+	}
+	uartSend(avr, gScript, gScriptLen);
+	run(avr, NULL);
+
+	if ( ! strstr(gSent, "done\r\n")) {
+		fprintf(stderr, "sim-core: sketch didn't finish the script\n");
+		gFailures++;
+	}
+
+	// timed calls
+	for (int m = 1; m < SIM_MARKERS; m++) {
+		avr_cycle_count_t expected =
+			(avr_cycle_count_t)avr->frequency / 1000000 * sim_marker_us[m];
+		const struct stats *s = &gCall[m];
+
+		if (expected == 0 || s->count == 0)
+			continue;
+		// delay() may end a micros() step early, interrupts make both
+		// take longer
+		if (average(s) < expected - expected / 50 ||
+		    average(s) > expected + expected / 20) {
+			fprintf(stderr, "sim-core: %s took %lu cycles, expected %lu\n",
+			        sim_marker_names[m], average(s),
+			        (unsigned long)expected);
+			gFailures++;
+		}
+	}
+}
+
+
+// bootloader scenarios
+
+static const char *mcuSignature(const char *mcu)
+{
+	if (strcmp(mcu, "atmega644") == 0)
+		return "\x1e\x96\x09";
+	if (strcmp(mcu, "atmega644p") == 0)
+		return "\x1e\x96\x0a";
+	if (strcmp(mcu, "atmega1284p") == 0)
+		return "\x1e\x97\x05";
+	return NULL;
+}
+
+// frames an STK500v2 message, returns its length
+static unsigned int stkMessage(unsigned char *out, unsigned char seq,
+                               const unsigned char *body, unsigned int len)
+{
+	unsigned char checksum = 0;
+	unsigned int n = 0, i;
+
+	out[n++] = 0x1B;
+	out[n++] = seq;
+	out[n++] = len >> 8;
+	out[n++] = len & 0xFF;
+	out[n++] = 0x0E;
+	memcpy(out + n, body, len);
+	n += len;
+	for (i = 0; i < n; i++)
+		checksum ^= out[i];
+	out[n++] = checksum;
+	return n;
+}
+
+static unsigned int gExpectLen;
+
+static int replyComplete(avr_t *avr)
+{
+	return gSentLen >= gExpectLen;
+}
+
+static int applicationStarted(avr_t *avr)
+{
+	return avr->pc == 0;
+}
+
+// sends one command, checks the answer's body, accounts the cycles from
+// the last byte of the command to the last of the answer
+static void stkCommand(avr_t *avr, enum sim_marker marker, const char *name,
+                       unsigned char seq, const unsigned char *body,
+                       unsigned int len, const unsigned char *answer,
+                       unsigned int answerLen)
+{
+	static unsigned char message[300];
+	unsigned char expected[300];
+	unsigned int n = stkMessage(message, seq, body, len);
+	unsigned int m = stkMessage(expected, seq, answer, answerLen);
+	avr_cycle_count_t sent;
+
+	gSentLen = 0;
+	gExpectLen = m;
+	uartSend(avr, message, n);
+	run(avr, replyComplete);
+	sent = gNextByte - gByteCycles;
+
+	if (gSentLen != m || memcmp(gSent, expected, m) != 0) {
+		fprintf(stderr, "sim-core: wrong answer to %s\n", name);
+		gFailures++;
+		return;
+	}
+	account(&gCall[marker], gSentCycle - sent);
+}
+
+static void runBootloader(avr_t *avr, const char *mcu, avr_flashaddr_t base)
+{
+	static const unsigned char signOn[] = { 0x01 };
+	static const unsigned char signOnAnswer[] = {
+		0x01, 0x00, 8, 'A', 'V', 'R', 'I', 'S', 'P', '_', '2' };
+	static const unsigned char leave[] = { 0x11, 1, 1 };
+	static const unsigned char leaveAnswer[] = { 0x11, 0x00 };
+	const char *signature = mcuSignature(mcu);
+	unsigned char seq = 1;
+	int i;
+
+	if ( ! signature) {
+		fprintf(stderr, "sim-core: no signature known for %s\n", mcu);
+		gFailures++;
+		return;
+	}
+
+	stkCommand(avr, SIM_BOOT_SIGN_ON, "CMD_SIGN_ON", seq++,
+	           signOn, sizeof(signOn), signOnAnswer, sizeof(signOnAnswer));
+	for (i = 0; i < 3; i++) {
+		unsigned char read[] = { 0x1B, 0, 0, 0, i };
+		unsigned char answer[] = { 0x1B, 0x00, signature[i], 0x00 };
+
+		stkCommand(avr, SIM_BOOT_READ_SIGNATURE, "CMD_READ_SIGNATURE_ISP",
+		           seq++, read, sizeof(read), answer, sizeof(answer));
+	}
+	stkCommand(avr, SIM_BOOT_LEAVE, "CMD_LEAVE_PROGMODE_ISP", seq++,
+	           leave, sizeof(leave), leaveAnswer, sizeof(leaveAnswer));
+	run(avr, applicationStarted);
+	if (avr->pc != 0) {
+		fprintf(stderr, "sim-core: bootloader didn't start the application\n");
+		gFailures++;
+	}
+
+	// no programmer this time, the bootloader gives up after about
+	// PROGRAMMER_WAIT_SECONDS (3 s)
+	avr_reset(avr);
+	avr->pc = base;
+	{
+		avr_cycle_count_t start = avr->cycle;
+		double seconds;
+
+		run(avr, applicationStarted);
+		seconds = (double)(avr->cycle - start) / avr->frequency;
+		account(&gCall[SIM_BOOT_TIMEOUT], avr->cycle - start);
+		if (avr->pc != 0 || seconds < 2.0 || seconds > 4.5) {
+			fprintf(stderr, "sim-core: bootloader waited %.2f s for a "
+			        "programmer, expected about 3 s\n", seconds);
+			gFailures++;
+		}
+	}
+}
+
+
+// output and baseline
+
+static void report(FILE *out)
+{
+	int i;
+
+	for (i = 1; i < MAX_VECTORS; i++)
+		if (gIsr[i].count)
+			fprintf(out, "isr\t%s\t%lu\t%lu\t%lu\n", gVectorNames[i],
+			        gIsr[i].count, average(&gIsr[i]),
+			        (unsigned long)gIsr[i].max);
+	for (i = 1; i < SIM_MARKERS; i++)
+		if (gCall[i].count)
+			fprintf(out, "call\t%s\t%lu\t%lu\t%lu\n", sim_marker_names[i],
+			        gCall[i].count, average(&gCall[i]),
+			        (unsigned long)gCall[i].max);
+}
+
+static const struct stats *lookup(const char *kind, const char *name)
+{
+	int i;
+
+	if (strcmp(kind, "isr") == 0) {
+		for (i = 1; i < MAX_VECTORS; i++)
+			if (strcmp(gVectorNames[i], name) == 0)
+				return &gIsr[i];
+	} else if (strcmp(kind, "call") == 0) {
+		for (i = 1; i < SIM_MARKERS; i++)
+			if (strcmp(sim_marker_names[i], name) == 0)
+				return &gCall[i];
+	}
+	return NULL;
+}
+
+static void compare(const char *path)
+{
+	char line[256], kind[16], name[64];
+	unsigned long count, avg, max;
+	FILE *f = fopen(path, "r");
+
+	if ( ! f) {
+		perror(path);
+		gFailures++;
+		return;
+	}
+	while (fgets(line, sizeof(line), f)) {
+		const struct stats *s;
+
+		if (sscanf(line, "%15[^\t]\t%63[^\t]\t%lu\t%lu\t%lu",
+		           kind, name, &count, &avg, &max) != 5)
+			continue;
+		s = lookup(kind, name);
+		if ( ! s || s->count == 0) {
+			fprintf(stderr, "sim-core: %s %s no longer runs\n", kind, name);
+			gFailures++;
+		} else if (average(s) > avg + avg / 20 + 2) {
+			fprintf(stderr, "sim-core: %s %s takes %lu cycles, "
+			        "was %lu\n", kind, name, average(s), avg);
+			gFailures++;
+		}
+	}
+	fclose(f);
+}
+
+static void overhead(const char *path)
+{
+	char line[256], kind[16], name[64];
+	unsigned long count, avg, max;
+	FILE *f = fopen(path, "r");
+
+	if ( ! f) {
+		perror(path);
+		gFailures++;
+		return;
+	}
+	while (fgets(line, sizeof(line), f)) {
+		const struct stats *s;
+		long added;
+
+		if (sscanf(line, "%15[^\t]\t%63[^\t]\t%lu\t%lu\t%lu",
+		           kind, name, &count, &avg, &max) != 5 ||
+		    strcmp(kind, "isr") != 0)
+			continue;
+		s = lookup(kind, name);
+		if ( ! s || s->count == 0) {
+			fprintf(stderr, "sim-core: isr %s doesn't run with the "
+			        "profiler\n", name);
+			gFailures++;
+			continue;
+		}
+		added = (long)average(s) - (long)avg;
+		printf("overhead\t%s\t%ld\n", name, added);
+		if (added > MAX_PROFILER_OVERHEAD) {
+			fprintf(stderr, "sim-core: the profiler adds %ld cycles to "
+			        "isr %s\n", added, name);
+			gFailures++;
+		}
+	}
+	fclose(f);
+}
+
+static unsigned char *readFile(const char *path, long *len)
+{
+	FILE *f = fopen(path, "rb");
+	unsigned char *data;
+
+	if ( ! f) {
+		perror(path);
+		exit(2);
+	}
+	fseek(f, 0, SEEK_END);
+	*len = ftell(f);
+	rewind(f);
+	data = malloc(*len + 1);
+	if ( ! data || fread(data, 1, *len, f) != (size_t)*len) {
+		perror(path);
+		exit(2);
+	}
+	fclose(f);
+	return data;
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"Usage: sim-core -m mcu [-f frequency] [-b] [-i script]\n"
+		"                [-r baseline] [-o reference] firmware.elf\n");
+	exit(2);
+}
+
+
+int main(int argc, char **argv)
+{
+	const char *mcu = NULL, *script = "scenario.gcode", *baseline = NULL;
+	const char *reference = NULL;
+	unsigned long frequency = 16000000;
+	int bootloader = 0, opt;
+	elf_firmware_t firmware;
+	avr_t *avr;
+
+	while ((opt = getopt(argc, argv, "m:f:bi:r:o:")) != -1) {
+		switch (opt) {
+		case 'm': mcu = optarg; break;
+		case 'f': frequency = strtoul(optarg, NULL, 10); break;
+		case 'b': bootloader = 1; break;
+		case 'i': script = optarg; break;
+		case 'r': baseline = optarg; break;
+		case 'o': reference = optarg; break;
+		default: usage();
+		}
+	}
+	if ( ! mcu || optind != argc - 1)
+		usage();
+
+	memset(&firmware, 0, sizeof(firmware));
+	if (elf_read_firmware(argv[optind], &firmware) != 0) {
+		fprintf(stderr, "sim-core: can't read %s\n", argv[optind]);
+		return 2;
+	}
+	avr = avr_make_mcu_by_name(mcu);
+	if ( ! avr) {
+		fprintf(stderr, "sim-core: simavr doesn't know %s\n", mcu);
+		return 2;
+	}
+	avr_init(avr);
+	avr->frequency = frequency;
+	avr_load_firmware(avr, &firmware);
+	uartSetup(avr);
+
+	printf("# %s at %lu Hz, %s\n", mcu, frequency, argv[optind]);
+	if (bootloader) {
+		// BOOTRST: reset goes to the boot section
+		avr->reset_pc = firmware.flashbase;
+		avr->pc = firmware.flashbase;
+		runBootloader(avr, mcu, firmware.flashbase);
+	} else {
+		gScript = readFile(script, &gScriptLen);
+		runApplication(avr);
+	}
+
+	report(stdout);
+	if (baseline)
+		compare(baseline);
+	if (reference)
+		overhead(reference);
+	if (gFailures)
+		fprintf(stderr, "sim-core: %d failures\n", gFailures);
+	return gFailures ? 1 : 0;
+}
@@ -0,0 +1,60 @@
+/*
+  Markers shared by the scenario sketch and the simulator: the sketch
+  writes a marker number to GPIOR0 before an API call and 0 after it,
+  sim-core counts the cycles in between. The SIM_BOOT_ ones are timed by
+  sim-core itself, from a command to the bootloader's answer.
+*/
+
+#ifndef sim_markers_h
+#define sim_markers_h
+
+enum sim_marker {
+	SIM_NONE,
+	SIM_MILLIS,
+	SIM_MICROS,
+	SIM_DIGITAL_WRITE,
+	SIM_DIGITAL_READ,
+	SIM_ANALOG_READ,
+	SIM_PRINT_LONG,
+	SIM_PRINT_FLOAT,
+	SIM_STRING_CONCAT,
+	SIM_DELAY_MICROSECONDS_100,
+	SIM_DELAY_10,
+	SIM_READ_LINE,
+	SIM_PARSE_LINE,
+	SIM_BOOT_SIGN_ON,
+	SIM_BOOT_READ_SIGNATURE,
+	SIM_BOOT_LEAVE,
+	SIM_BOOT_TIMEOUT,
+	SIM_MARKERS
+};
+
+#ifdef SIM_MARKER_NAMES
+static const char * const sim_marker_names[SIM_MARKERS] = {
+	"",
+	"millis()",
+	"micros()",
+	"digitalWrite()",
+	"digitalRead()",
+	"analogRead()",
+	"Serial.print(long)",
+	"Serial.print(float)",
+	"String+=",
+	"delayMicroseconds(100)",
+	"delay(10)",
+	"Serial.readBytesUntil()",
+	"parse G1 line",
+	"stk500v2 sign on",
+	"stk500v2 read signature",
+	"stk500v2 leave",
+	"bootloader timeout",
+};
+
+// calls which have to take a known time [us], 0 for don't care
+static const unsigned long sim_marker_us[SIM_MARKERS] = {
+	[SIM_DELAY_MICROSECONDS_100] = 100,
+	[SIM_DELAY_10] = 10000,
+};
+#endif
+
+#endif
@@ -0,0 +1,75 @@
+/*
+  Scenario sketch for sim-core: times the core's API calls between
+  GPIOR0 markers, then reads the G-code sim-core sends over the UART and
+  answers each line with "ok", like a firmware would. "M2" ends the run.
+*/
+
+#include <avr/sleep.h>
+#include "Arduino.h"
+#include "FixedString.h"
+#include "sim-markers.h"
+
+#define MARK(marker, call) do { GPIOR0 = (marker); call; GPIOR0 = SIM_NONE; } while (0)
+
+static volatile unsigned long sink;
+
+static void apiCalls(void)
+{
+	String s;
+
+	for (uint8_t i = 0; i < 16; i++) {
+		MARK(SIM_MILLIS, sink = millis());
+		MARK(SIM_MICROS, sink = micros());
+		MARK(SIM_DIGITAL_WRITE, digitalWrite(13, i & 1));
+		MARK(SIM_DIGITAL_READ, sink = digitalRead(12));
+		MARK(SIM_ANALOG_READ, sink = analogRead(0));
+		MARK(SIM_PRINT_LONG, Serial.print(-1234567L));
+		MARK(SIM_PRINT_FLOAT, Serial.print(123.456, 3));
+		Serial.println();
+		MARK(SIM_STRING_CONCAT, s += 'x');
+		MARK(SIM_DELAY_MICROSECONDS_100, delayMicroseconds(100));
+		MARK(SIM_DELAY_10, delay(10));
+	}
+}
+
+void setup()
+{
+	Serial.begin(115200);
+	pinMode(13, OUTPUT);
+	pinMode(12, INPUT);
+	apiCalls();
+	Serial.println("ready");
+}
+
+void loop()
+{
+	FixedString<64> line;
+	size_t n;
+
+	MARK(SIM_READ_LINE, n = Serial.readBytesUntil('\n', line));
+	if (n == 0)
+		return;
+
+	GPIOR0 = SIM_PARSE_LINE;
+	long x = 0, y = 0;
+	int i = line.indexOf('X');
+	if (i >= 0) x = line.substring(i + 1).toInt();
+	i = line.indexOf('Y');
+	if (i >= 0) y = line.substring(i + 1).toInt();
+	GPIOR0 = SIM_NONE;
+	sink = x + y;
+
+	if (line == "M2") {
+		Serial.println("done");
+		Serial.flush();
+		// sleeping with interrupts disabled ends the simulation, and
+		// stops a real processor for good
+		set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+		sleep_enable();
+		cli();
+		sleep_cpu();
+		for (;;)
+			;
+	}
+	Serial.println("ok");
+}
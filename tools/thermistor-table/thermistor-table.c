@@ -0,0 +1,371 @@
+/*
+  Tool to create the ADC reading -> temperature lookup table for a
+  thermistor input of Generation 7 Electronics. The model is the one of
+  research/Thermistor.gnumeric: a NTC thermistor between the ADC input and
+  ground, a pull-up resistor between the input and the ADC reference.
+
+  Output is C source for the firmware, to be used with thermistorToTemp()
+  from Thermistor.h of the Gen7 Arduino core. Temperatures in the table
+  are in quarter degrees Celsius, so the firmware needs no floating point.
+
+  Permission to use, copy, modify, and/or distribute this software for
+  any purpose with or without fee is hereby granted, provided that the
+  above copyright notice and this permission notice appear in all copies.
+
+  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL
+  WARRANTIES WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED
+  WARRANTIES OF MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR
+  BE LIABLE FOR ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES
+  OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS,
+  WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION,
+  ARISING OUT OF OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS
+  SOFTWARE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+
+#define KELVIN 273.15
+#define ADC_MAX 1023
+
+// Defaults are the values of research/Thermistor.gnumeric.
+static double gR0 = 100000.;        // resistance at gT0 [ohms]
+static double gT0 = 25.;            // [°C]
+static double gBeta = 4085.;
+static double gPullUp = 560.;       // [ohms]
+static int    gSteinhartHart = 0;   // use gA, gB, gC instead of beta
+static double gA, gB, gC;
+static int    gSize = 20;           // number of table entries
+static double gMaxError = 0.;       // [°C], 0 means fit into gSize
+static double gTMin = 0.;           // [°C]
+static double gTMax = 300.;         // [°C]
+static const char *gName = "thermistorTable";
+
+
+// Thermistor resistance at a temperature.
+static double
+resistance(double t) {
+  t += KELVIN;
+  if (gSteinhartHart) {
+    // Solve 1/T = A + B ln(R) + C ln(R)^3 for ln(R).
+    double x = (gA - 1. / t) / gC;
+    double y = sqrt(pow(gB / (3. * gC), 3.) + x * x / 4.);
+    return exp(cbrt(y - x / 2.) - cbrt(y + x / 2.));
+  }
+  return gR0 * exp(gBeta * (1. / t - 1. / (gT0 + KELVIN)));
+}
+
+// Temperature at a thermistor resistance.
+static double
+temperature(double r) {
+  double l = log(r);
+
+  if (gSteinhartHart)
+    return 1. / (gA + gB * l + gC * l * l * l) - KELVIN;
+  return 1. / (1. / (gT0 + KELVIN) + log(r / gR0) / gBeta) - KELVIN;
+}
+
+// The ADC is fed from the same reference as the pull-up, so readings
+// depend on the resistor ratio only.
+static double
+adc_reading(double t) {
+  double r = resistance(t);
+  return (ADC_MAX + 1) * r / (r + gPullUp);
+}
+
+static double
+adc_temperature(double adc) {
+  return temperature(gPullUp * adc / (ADC_MAX + 1 - adc));
+}
+
+// Temperature in quarter degrees as stored in the table.
+static long
+quarters(double t) {
+  long t4 = (long)floor(t * 4. + 0.5);
+  return t4 < 0 ? 0 : t4;
+}
+
+// Table values of entry i, as thermistorToTemp() gets them.
+static void
+entry(const int *adc, int n, int i, long *t4, long *slope) {
+  *t4 = quarters(adc_temperature(adc[i]));
+  *slope = 0;
+  if (i < n - 1 && adc[i + 1] > adc[i]) {
+    double d = adc_temperature(adc[i]) - adc_temperature(adc[i + 1]);
+    *slope = (long)floor(d * 4. * 256. / (adc[i + 1] - adc[i]) + 0.5);
+  }
+}
+
+// Result of thermistorToTemp() for a reading in the segment starting at
+// a table entry, with the same integer arithmetic.
+static long
+interpolate(int base, long t4, long slope, int reading) {
+  long drop = ((long)(reading - base) * slope) >> 8;
+  return drop < t4 ? t4 - drop : 0;
+}
+
+// Worst difference in degrees between the interpolation from a to b and
+// the real curve, or a huge value if the slope doesn't fit the table.
+static double
+segment_error(int a, int b) {
+  int pair[2] = { a, b };
+  long t4, slope;
+  double worst = 0.;
+  int r;
+
+  entry(pair, 2, 0, &t4, &slope);
+  if (slope > 65535)
+    return 1e9;
+  for (r = a; r <= b; r++) {
+    double real = adc_temperature(r);
+    double e;
+
+    if (real < 0.)
+      real = 0.;
+    e = fabs(interpolate(a, t4, slope, r) / 4. - real);
+    if (r == b)
+      e = fabs(quarters(adc_temperature(b)) / 4. - real);
+    if (e > worst)
+      worst = e;
+  }
+  return worst;
+}
+
+// Places entries from lo to hi, each segment as long as the error bound
+// allows. Returns the number of entries, or -1 if more than max are
+// needed.
+static int
+place(int *adc, int lo, int hi, double bound, int max) {
+  int n = 0, a = lo;
+
+  for (;;) {
+    int b = a + 1;
+
+    if (n >= max)
+      return -1;
+    adc[n++] = a;
+    if (a >= hi)
+      return n;
+    while (b < hi && segment_error(a, b + 1) <= bound)
+      b++;
+    a = b;
+  }
+}
+
+// Worst error of a whole table, and where it happens.
+static double
+table_error(const int *adc, int n, int *where) {
+  double worst = 0.;
+  int i, r;
+
+  *where = adc[0];
+  for (i = 0; i < n - 1; i++) {
+    long t4, slope;
+
+    entry(adc, n, i, &t4, &slope);
+    if (slope > 65535)
+      slope = 65535;
+    for (r = adc[i]; r < adc[i + 1]; r++) {
+      double real = adc_temperature(r);
+      double e;
+
+      if (real < 0.)
+        real = 0.;
+      e = fabs(interpolate(adc[i], t4, slope, r) / 4. - real);
+      if (e > worst) {
+        worst = e;
+        *where = r;
+      }
+    }
+  }
+  return worst;
+}
+
+static void
+version(void) {
+  printf("Thermistor Table Generator v1.1\n");
+}
+
+static void
+usage(char * const argv0) {
+  printf("\n");
+  version();
+  printf("\n");
+  printf("Creates a lookup table to convert ADC readings of a thermistor\n");
+  printf("input into temperatures, as C source for the firmware.\n");
+  printf("Defaults are those of research/Thermistor.gnumeric.\n");
+  printf("\n");
+  printf("Usage: %s [-hV] [-r <R0>] [-t <T0>] [-b <beta>]\n", argv0);
+  printf("       [-s <A>,<B>,<C>] [-p <pull-up>] [-n <size>]\n");
+  printf("       [-l <min temp>] [-u <max temp>] [-e <max error>]\n");
+  printf("       [-o <name>]\n");
+  printf("\n");
+  printf("Options:\n");
+  printf("  -r  Thermistor resistance at T0 in ohms (default %g).\n", gR0);
+  printf("  -t  T0 in degrees Celsius (default %g).\n", gT0);
+  printf("  -b  Beta of the thermistor (default %g).\n", gBeta);
+  printf("  -s  Use Steinhart-Hart coefficients instead of R0, T0 and beta.\n");
+  printf("  -p  Pull-up resistor in ohms (default %g).\n", gPullUp);
+  printf("  -n  Number of table entries, 2 to 255 (default %d).\n", gSize);
+  printf("  -e  Allowed interpolation error in degrees instead of -n; the\n");
+  printf("      table gets as many entries as this needs.\n");
+  printf("  -l  Lowest temperature to cover (default %g).\n", gTMin);
+  printf("  -u  Highest temperature to cover (default %g).\n", gTMax);
+  printf("  -o  Name of the table (default %s).\n", gName);
+  printf("  -h  Display this help and exit.\n");
+  printf("  -V  Display version and exit.\n");
+}
+
+int
+main (int argc, char * const argv[]) {
+  int ch, i, n, worstAdc;
+  int *adc;
+  double lo, hi, worst;
+
+  while ((ch = getopt(argc, argv, "b:e:hl:n:o:p:r:s:t:u:V")) != -1) {
+    switch (ch) {
+      case 'b':
+        gBeta = atof(optarg);
+        break;
+      case 'e':
+        gMaxError = atof(optarg);
+        break;
+      case 'h':
+        usage(argv[0]);
+        exit(0);
+        break;
+      case 'l':
+        gTMin = atof(optarg);
+        break;
+      case 'n':
+        gSize = atoi(optarg);
+        break;
+      case 'o':
+        gName = optarg;
+        break;
+      case 'p':
+        gPullUp = atof(optarg);
+        break;
+      case 'r':
+        gR0 = atof(optarg);
+        break;
+      case 's':
+        if (sscanf(optarg, "%lf,%lf,%lf", &gA, &gB, &gC) != 3) {
+          fprintf(stderr, "-s needs three comma separated numbers.\n");
+          exit(-1);
+        }
+        gSteinhartHart = 1;
+        break;
+      case 't':
+        gT0 = atof(optarg);
+        break;
+      case 'u':
+        gTMax = atof(optarg);
+        break;
+      case 'V':
+        version();
+        exit(0);
+        break;
+      case '?':
+      default:
+        usage(argv[0]);
+        exit(-1);
+        break;
+    }
+  }
+
+  if (gSize < 2 || gSize > 255 || gTMin >= gTMax || gPullUp <= 0. ||
+      (gSteinhartHart && gC == 0.) || ( ! gSteinhartHart && gBeta <= 0.)) {
+    fprintf(stderr, "Invalid parameters, see -h.\n");
+    exit(-1);
+  }
+
+  // A NTC's reading falls with temperature. The range is rounded outwards,
+  // so readings of both end temperatures are inside the table.
+  lo = floor(adc_reading(gTMax));
+  hi = ceil(adc_reading(gTMin));
+  if (lo < 1)
+    lo = 1;
+  if (hi > ADC_MAX)
+    hi = ADC_MAX;
+  if (hi - lo < gSize - 1) {
+    fprintf(stderr, "Temperature range covers only %d ADC steps, use a "
+                    "smaller table.\n", (int)(hi - lo));
+    exit(-1);
+  }
+
+  adc = malloc(256 * sizeof(int)); // Free'd at program exit.
+  if ( ! adc) {
+    fprintf(stderr, "Out of memory.\n");
+    exit(-1);
+  }
+
+  // The curve is steep and almost straight at high temperatures, but flat
+  // and strongly bent at low ones, so evenly spaced entries leave huge
+  // errors near room temperature. Entries are placed instead by making
+  // each segment as long as the error bound allows. Without -e, the
+  // smallest bound that fits into the requested number of entries is
+  // searched for.
+  if (gMaxError > 0.) {
+    n = place(adc, (int)lo, (int)hi, gMaxError, 255);
+    if (n < 0) {
+      fprintf(stderr, "Error bound needs more than 255 entries.\n");
+      exit(-1);
+    }
+  } else {
+    double good = 200., bad = 0.;
+
+    if (place(adc, (int)lo, (int)hi, good, gSize) < 0) {
+      fprintf(stderr, "Can't fit the table into %d entries.\n", gSize);
+      exit(-1);
+    }
+    while (good - bad > 0.001) {
+      double e = (good + bad) / 2.;
+      if (place(adc, (int)lo, (int)hi, e, gSize) < 0)
+        bad = e;
+      else
+        good = e;
+    }
+    n = place(adc, (int)lo, (int)hi, good, gSize);
+  }
+  worst = table_error(adc, n, &worstAdc);
+
+  printf("// Thermistor table, generated by thermistor-table with:\n");
+  if (gSteinhartHart)
+    printf("//   Steinhart-Hart A = %g, B = %g, C = %g\n", gA, gB, gC);
+  else
+    printf("//   R0 = %g ohms at T0 = %g C, beta = %g\n", gR0, gT0, gBeta);
+  printf("//   pull-up = %g ohms, %g C to %g C\n", gPullUp, gTMin, gTMax);
+  printf("//\n");
+  printf("// Worst interpolation error: %.2f C at ADC %d.\n", worst, worstAdc);
+  printf("//\n");
+  printf("// Entries are { ADC reading, temperature [C/4], slope to the next\n");
+  printf("// entry [C/4 per ADC step * 256] }.\n");
+  printf("\n");
+  printf("#include <Thermistor.h>\n");
+  printf("\n");
+  printf("const ThermistorEntry %s[%d] PROGMEM = {\n", gName, n);
+  for (i = 0; i < n; i++) {
+    long t4, slope;
+
+    entry(adc, n, i, &t4, &slope);
+    if (slope > 65535) {
+      fprintf(stderr, "Warning: slope at ADC %d too steep, clipped.\n",
+              adc[i]);
+      slope = 65535;
+    }
+    printf("  { %4d, %5ld, %5ld }%s  // %6.2f C\n", adc[i], t4, slope,
+           i < n - 1 ? "," : " ", adc_temperature(adc[i]));
+  }
+  printf("};\n");
+
+  if (worst > 1.)
+    fprintf(stderr, "Warning: interpolation is off by up to %.2f C at "
+                    "ADC %d. Use a larger table.\n", worst, worstAdc);
+
+  return 0;
+}